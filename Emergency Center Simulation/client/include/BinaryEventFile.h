@@ -0,0 +1,33 @@
+#pragma once
+
+#include "event.h"
+#include <string>
+
+// Compact binary alternative to the events_*.json files accepted by report.
+//
+// All integers are little-endian. Every distinct string (channel, names,
+// cities, descriptions, general_information keys and string values) is stored
+// once in a length-prefixed string table and referenced by index:
+//
+//   header   "EMIB" | u32 version | u32 string count | u32 event count | u32 channel string
+//   strings  string count x (u32 length | bytes)
+//   events   event count x (u32 name | u32 city | i64 date_time | u32 description |
+//                           u32 info count | info count x (u32 key | u8 kind | value))
+//
+// The kind is a DetailValue::Kind and the value is a u8 for Bool, an i64 for
+// Int, the IEEE bits of a Double as an i64, or a u32 string index for String.
+// Version 1 files, whose info entries are (u32 key | u32 value string), are
+// still read; their values get their kind from DetailValue::parse.
+//
+// Loading maps the file and copies the strings out by offset, with no text parsing.
+static const char BINARY_EVENTS_MAGIC[4] = {'E', 'M', 'I', 'B'};
+static const unsigned BINARY_EVENTS_VERSION = 2;
+
+// True if the file starts with BINARY_EVENTS_MAGIC
+bool isBinaryEventsFile(const std::string& path);
+
+// Returns false if the file cannot be written
+bool writeBinaryEventsFile(const names_and_events& data, const std::string& path);
+
+// Throws std::runtime_error on a missing, truncated or malformed file, like parseEventsFile
+names_and_events readBinaryEventsFile(const std::string& path);
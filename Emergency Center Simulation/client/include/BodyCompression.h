@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <zlib.h>
+
+// Opt-in compression of report bodies ("compress on").
+//
+// A compressed SEND carries "content-encoding:deflate-emi" and a body that is
+// raw deflate, primed with a dictionary of the report keys and common values
+// that both sides compile in, then base64 encoded: the server splits frames on
+// '\n', trims bodies and ends them at '\0', so the body has to stay one line of
+// printable text. The server copies the header onto the MESSAGE frames and
+// StompProtocol inflates the body before decoding it.
+//
+// Changing the dictionary breaks compatibility with older clients; bump the
+// encoding name with it.
+static const char BODY_CONTENT_ENCODING[] = "deflate-emi";
+
+class BodyCompressor {
+private:
+    z_stream stream;
+    bool ready;
+    std::string buffer;
+
+public:
+    BodyCompressor();
+    ~BodyCompressor();
+    BodyCompressor(const BodyCompressor&) = delete;
+    BodyCompressor& operator=(const BodyCompressor&) = delete;
+
+    // Appends the encoded body to out. Returns false, appending nothing, when
+    // compression would not make the body smaller; send it as is then.
+    bool compress(std::string_view body, std::string& out);
+};
+
+class BodyDecompressor {
+private:
+    z_stream stream;
+    bool ready;
+    std::string buffer;
+
+public:
+    // Larger bodies are rejected rather than inflated
+    static constexpr size_t MAX_BODY_SIZE = 1 << 20;
+
+    BodyDecompressor();
+    ~BodyDecompressor();
+    BodyDecompressor(const BodyDecompressor&) = delete;
+    BodyDecompressor& operator=(const BodyDecompressor&) = delete;
+
+    // Replaces out with the decoded body. Returns false on malformed input.
+    bool decompress(std::string_view encoded, std::string& out);
+};
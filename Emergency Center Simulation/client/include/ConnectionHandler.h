@@ -1,25 +1,69 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 #include <iostream>
 #include <boost/asio.hpp>
 
 using boost::asio::ip::tcp;
 
+// Options applied to every socket a ConnectionHandler opens; false / 0 keeps the OS default.
+// The TCP ones are ignored on Unix-domain sockets. A failing option is reported and skipped.
+struct SocketOptions {
+	bool noDelay;       // TCP_NODELAY
+	bool quickAck;      // TCP_QUICKACK, re-armed after every read since the kernel clears it
+	int sendBuffer;     // SO_SNDBUF in bytes
+	int receiveBuffer;  // SO_RCVBUF in bytes
+	int busyPollMicros; // SO_BUSY_POLL; above net.core.busy_read it needs CAP_NET_ADMIN
+	bool ioUring;       // send and receive through io_uring (see UringSocket.h), falling back to asio
+
+	SocketOptions()
+	    : noDelay(false), quickAck(false), sendBuffer(0), receiveBuffer(0), busyPollMicros(0), ioUring(false) {}
+};
+
+// A host of the form "unix:{path}" connects to the Unix-domain stream socket at path instead of TCP
+static const char UNIX_HOST_PREFIX[] = "unix:";
+
+class UringSocket;
+
 class ConnectionHandler {
 private:
 	const std::string host_;
 	const short port_;
+	const SocketOptions options_;
+	const bool local_; // Unix-domain transport
 	boost::asio::io_service io_service_;   // Provides core I/O functionality
-	tcp::socket socket_;
+	boost::asio::generic::stream_protocol::socket socket_; // TCP or Unix-domain
+	// Metrics::now() of the last successful read and write, for heart-beating
+	std::atomic<uint64_t> lastReceive_;
+	std::atomic<uint64_t> lastSend_;
+	std::unique_ptr<UringSocket> uring_; // set when connected with SocketOptions::ioUring
+	// Received bytes not handed out yet are readBuffer_[readStart_, readEnd_); only the reader uses them
+	std::vector<char> readBuffer_;
+	size_t readStart_;
+	size_t readEnd_;
+
+	void applyOptions();
+	// Read whatever the socket has, at least one byte, into the emptied readBuffer_
+	bool fill();
+	template <typename Option>
+	void setOption(const Option& option, const char* name);
 
 public:
-	ConnectionHandler(std::string host, short port);
+	// A longer frame is copied out of the buffer piece by piece as it arrives
+	static constexpr size_t READ_BUFFER_SIZE = 64 << 10;
+
+	ConnectionHandler(std::string host, short port, const SocketOptions& options = SocketOptions());
 
 	virtual ~ConnectionHandler();
 
-	// Connect to the remote machine
-	bool connect();
+	// Connect to the remote machine; announce prints the attempt, as the login does
+	bool connect(bool announce = true);
+
+	static bool isUnixHost(const std::string& host);
 
 	// Read a fixed number of bytes from the server - blocking.
 	// Returns false in case the connection is closed before bytesToRead bytes can be read.
@@ -37,10 +81,15 @@ public:
 	// Returns false in case connection closed before all the data is sent.
 	bool sendLine(std::string &line);
 
-	// Get Ascii data from the server until the delimiter character
+	// Get Ascii data from the server until the delimiter character, skipping the
+	// newlines a server sends as heart-beats between frames.
 	// Returns false in case connection closed before null can be read.
 	bool getFrameAscii(std::string &frame, char delimiter);
 
+	// Whether a whole frame up to delimiter was already received, so getFrameAscii returns it
+	// without waiting for the socket
+	bool hasBufferedFrame(char delimiter) const;
+
 	// Send a message to the remote host.
 	// Returns false in case connection is closed before all the data is sent.
 	bool sendFrameAscii(const std::string &frame, char delimiter);
@@ -48,4 +97,10 @@ public:
 	// Close down the connection properly.
 	void close();
 
+	// Shut both directions down without closing, so a read blocked in another thread returns false.
+	void shutdown();
+
+	uint64_t lastReceiveTime() const { return lastReceive_.load(std::memory_order_relaxed); }
+	uint64_t lastSendTime() const { return lastSend_.load(std::memory_order_relaxed); }
+
 }; //class ConnectionHandler
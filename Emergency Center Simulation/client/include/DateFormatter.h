@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <ctime>
+
+// Formats epoch seconds as local "%d/%m/%Y %H:%M:%S" without going through
+// std::localtime / put_time. The timezone offset is looked up with
+// localtime_r once per ~24 day window and cached per thread, so the
+// formatter can be shared freely between threads.
+class DateFormatter {
+public:
+    // Length of a formatted timestamp, e.g. "13/06/2024 00:00:00"
+    static constexpr std::size_t LENGTH = 19;
+
+    // Write exactly LENGTH characters to out (no terminating null).
+    void format(long epochTime, char* out) const;
+
+    std::string format(long epochTime) const;
+
+    // Offset of local time from UTC in seconds at the given instant.
+    static long utcOffset(long epochTime);
+
+private:
+    static const char digitPairs[201];
+};
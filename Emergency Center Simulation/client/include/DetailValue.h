@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// One general_information value: a boolean, an integer, a decimal or a string,
+// as the JSON event files write them. The kind survives parsing, storage and
+// the trip through a report body, so a flag is tested as a bool and a number
+// can be summed without reading text.
+//
+// A string value is a pointer to a reference-counted buffer that its copies
+// share. Strings up to MAX_INTERNED_LENGTH bytes, the flags, units and names a
+// vocabulary repeats, are interned process-wide so equal ones share a buffer;
+// the table only holds strings some value still refers to. Longer strings are
+// not looked up and each gets its own buffer. The empty string is no buffer at
+// all, so a default-constructed value takes no lock and allocates nothing.
+//
+// In a report body a value is its text (see appendTo). parse reads the kind
+// back from that text, and only from the one spelling appendTo would produce,
+// so "007" or "1.50" stay strings and every value's text round-trips unchanged.
+// A string spelled like a boolean or a number, such as "true", does come back
+// as that kind: the body has no quoting to tell them apart.
+class DetailValue {
+public:
+    enum Kind : uint8_t { Bool, Int, Double, String };
+    static constexpr size_t MAX_INTERNED_LENGTH = 64;
+
+    // The empty string
+    DetailValue();
+    DetailValue(const DetailValue& other);
+    DetailValue(DetailValue&& other) noexcept;
+    DetailValue& operator=(const DetailValue& other);
+    DetailValue& operator=(DetailValue&& other) noexcept;
+    ~DetailValue();
+
+    static DetailValue fromBool(bool value);
+    static DetailValue fromInt(int64_t value);
+    static DetailValue fromDouble(double value);
+    static DetailValue fromString(std::string_view value);
+    // The value whose text is text: true / false, an integer, a decimal, or else a string
+    static DetailValue parse(std::string_view text);
+
+    Kind kind() const { return type; }
+    bool isTrue() const { return type == Bool && value.flag; }
+    bool isNumber() const { return type == Int || type == Double; }
+    // Only meaningful for the matching kind; asDouble also converts an Int
+    bool asBool() const { return value.flag; }
+    int64_t asInt() const { return value.integer; }
+    double asDouble() const { return type == Int ? static_cast<double>(value.integer) : value.decimal; }
+    const std::string& asString() const;
+
+    // Append the text of the value: true / false, the integer, the shortest decimal that reads
+    // back the same with at least one fractional digit, or the string as is
+    void appendTo(std::string& out) const;
+    std::string toString() const;
+
+    bool operator==(const DetailValue& other) const;
+    bool operator!=(const DetailValue& other) const { return !(*this == other); }
+
+private:
+    struct SharedString;
+    struct InternTable;
+    union Payload {
+        bool flag;
+        int64_t integer;
+        double decimal;
+        SharedString* text; // nullptr is the empty string
+    };
+
+    Kind type;
+    Payload value;
+
+    static InternTable& internTable();
+    static SharedString* share(std::string_view text);
+    static void release(SharedString* text);
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "event.h"
+#include <random>
+#include <string>
+
+struct EventGeneratorOptions {
+    size_t eventCount;
+    std::string channel;        // empty picks a channel at random
+    unsigned seed;
+    long startTime;             // first possible date_time
+    long timeSpan;              // events fall in [startTime, startTime + timeSpan)
+    size_t meanDescriptionLength;
+    EventGeneratorOptions()
+        : eventCount(100), channel(""), seed(1), startTime(1718236800), timeSpan(7 * 24 * 60 * 60),
+          meanDescriptionLength(120) {}
+};
+
+// Produces synthetic emergency events shaped like the course sample files:
+// a few busy channels, a long tail of cities, log-normally distributed
+// description lengths and general_information with the usual boolean flags
+// plus optional numeric and string keys. The same seed gives the same events.
+class EventGenerator {
+private:
+    EventGeneratorOptions options;
+    std::mt19937 rng;
+    std::discrete_distribution<size_t> channelDistribution;
+    std::discrete_distribution<size_t> cityDistribution;
+
+    std::string pickChannel();
+    std::string pickCity();
+    std::string pickEventName(const std::string& channel);
+    std::string makeDescription();
+    std::map<std::string, DetailValue> makeGeneralInformation();
+
+public:
+    explicit EventGenerator(const EventGeneratorOptions& options);
+
+    // Events in memory, in the form parseEventsFile returns them
+    names_and_events generate();
+
+    // Write events in the events_*.json schema. Returns false if the file cannot be written.
+    static bool writeJson(const names_and_events& data, const std::string& path);
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "event.h"
+#include <memory>
+#include <string>
+
+// Loads an events_*.json file. parseEventsFile goes through the default
+// backend, chosen at build time (make JSON_BACKEND=fast selects FastJson);
+// the others stay available by name for comparison.
+//
+// Every backend throws std::runtime_error on a missing or malformed file.
+class EventSource {
+public:
+    virtual ~EventSource();
+    virtual names_and_events load(const std::string& path) = 0;
+    virtual const char* name() const = 0;
+
+    // The backend selected at build time
+    static std::unique_ptr<EventSource> create();
+    // "nlohmann" or "fast"; nullptr for an unknown name
+    static std::unique_ptr<EventSource> create(const std::string& name);
+};
+
+// Builds the whole document as an nlohmann::json DOM, then converts it
+class NlohmannEventSource : public EventSource {
+public:
+    names_and_events load(const std::string& path) override;
+    const char* name() const override { return "nlohmann"; }
+};
+
+// Walks the file once with the on-demand FastJson cursor, no DOM
+class FastJsonEventSource : public EventSource {
+public:
+    names_and_events load(const std::string& path) override;
+    const char* name() const override { return "fast"; }
+};
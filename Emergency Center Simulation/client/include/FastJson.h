@@ -0,0 +1,266 @@
+#pragma once
+
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Minimal on-demand JSON reader. Nothing is materialised up front: the caller
+// walks the document with a cursor and pulls out just the values it wants,
+// skipping the rest. Strings without escapes are returned as views into the
+// input buffer, so reading a key or a plain value does not allocate.
+//
+// The input must stay alive and unchanged while views into it are in use.
+// Malformed input throws std::runtime_error with the byte offset.
+class FastJson {
+private:
+    const char* begin;
+    const char* p;
+    const char* end;
+
+    [[noreturn]] void fail(const char* what) const {
+        throw std::runtime_error(std::string("JSON parse error at byte ") + std::to_string(p - begin) + ": " + what);
+    }
+
+    static void appendUtf8(std::string& out, unsigned codePoint) {
+        if (codePoint < 0x80) {
+            out += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            out += static_cast<char>(0xc0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3f));
+        } else if (codePoint < 0x10000) {
+            out += static_cast<char>(0xe0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (codePoint & 0x3f));
+        } else {
+            out += static_cast<char>(0xf0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+    }
+
+    unsigned hex4() {
+        if (end - p < 4) fail("truncated \\u escape");
+        unsigned value = 0;
+        for (int i = 0; i < 4; ++i, ++p) {
+            char c = *p;
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else fail("bad \\u escape");
+        }
+        return value;
+    }
+
+    // Decodes the rest of a string whose first escape is at p; prefix is the part before it
+    std::string decodeEscapes(std::string_view prefix) {
+        std::string out(prefix);
+        while (p < end && *p != '"') {
+            if (*p != '\\') {
+                const char* run = p;
+                while (p < end && *p != '"' && *p != '\\') ++p;
+                out.append(run, p - run);
+                continue;
+            }
+            if (++p == end) break;
+            char c = *p++;
+            switch (c) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    unsigned codePoint = hex4();
+                    if (codePoint >= 0xd800 && codePoint < 0xdc00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                        p += 2;
+                        unsigned low = hex4();
+                        codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+                    }
+                    appendUtf8(out, codePoint);
+                    break;
+                }
+                default: fail("bad escape");
+            }
+        }
+        if (p == end) fail("unterminated string");
+        ++p;
+        return out;
+    }
+
+public:
+    FastJson(const char* data, size_t size) : begin(data), p(data), end(data + size) {}
+
+    void skipWhitespace() {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) ++p;
+    }
+
+    // Next significant character without consuming it, '\0' at the end of input
+    char peek() {
+        skipWhitespace();
+        return p < end ? *p : '\0';
+    }
+
+    void expect(char c) {
+        if (peek() != c) {
+            char message[] = "expected 'x'";
+            message[10] = c;
+            fail(message);
+        }
+        ++p;
+    }
+
+    // Reads a string. Returns true and sets view when it has no escapes;
+    // otherwise returns false and sets decoded.
+    bool string(std::string_view& view, std::string& decoded) {
+        expect('"');
+        const char* start = p;
+        const void* stop = std::memchr(p, '"', end - p);
+        if (stop == nullptr) fail("unterminated string");
+        const void* escape = std::memchr(p, '\\', static_cast<const char*>(stop) - p);
+        if (escape == nullptr) {
+            p = static_cast<const char*>(stop) + 1;
+            view = std::string_view(start, static_cast<const char*>(stop) - start);
+            return true;
+        }
+        p = static_cast<const char*>(escape);
+        decoded = decodeEscapes(std::string_view(start, p - start));
+        return false;
+    }
+
+    std::string string() {
+        std::string_view view;
+        std::string decoded;
+        return string(view, decoded) ? std::string(view) : decoded;
+    }
+
+    // Number token as written
+    std::string_view number() {
+        skipWhitespace();
+        const char* start = p;
+        while (p < end && (std::strchr("+-.eE", *p) != nullptr || (*p >= '0' && *p <= '9'))) ++p;
+        if (p == start) fail("expected a number");
+        return std::string_view(start, p - start);
+    }
+
+    // Integer value; fractional numbers are truncated
+    long long integer() {
+        std::string_view token = number();
+        long long value = 0;
+        auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+        if (result.ec == std::errc() && result.ptr == token.data() + token.size()) return value;
+        double real = 0;
+        result = std::from_chars(token.data(), token.data() + token.size(), real);
+        if (result.ec != std::errc() || result.ptr != token.data() + token.size()) fail("bad number");
+        return static_cast<long long>(real);
+    }
+
+    // Iterates an object. onMember(key) is called per member with the cursor on
+    // its value and must consume that value (read it or skipValue()).
+    template <typename OnMember>
+    void object(OnMember onMember) {
+        expect('{');
+        if (peek() == '}') {
+            ++p;
+            return;
+        }
+        while (true) {
+            std::string_view key;
+            std::string decodedKey;
+            if (!string(key, decodedKey)) key = decodedKey;
+            expect(':');
+            onMember(key);
+            char c = peek();
+            ++p;
+            if (c == '}') return;
+            if (c != ',') fail("expected ',' or '}'");
+        }
+    }
+
+    // Iterates an array; onElement() must consume each element
+    template <typename OnElement>
+    void array(OnElement onElement) {
+        expect('[');
+        if (peek() == ']') {
+            ++p;
+            return;
+        }
+        while (true) {
+            onElement();
+            char c = peek();
+            ++p;
+            if (c == ']') return;
+            if (c != ',') fail("expected ',' or ']'");
+        }
+    }
+
+    void skipValue() {
+        char c = peek();
+        if (c == '"') {
+            std::string_view view;
+            std::string decoded;
+            string(view, decoded);
+        } else if (c == '{') {
+            object([this](std::string_view) { skipValue(); });
+        } else if (c == '[') {
+            array([this]() { skipValue(); });
+        } else if (c == 't' || c == 'f' || c == 'n') {
+            literal();
+        } else {
+            number();
+        }
+    }
+
+    // true, false or null
+    std::string_view literal() {
+        skipWhitespace();
+        for (std::string_view word : {std::string_view("true"), std::string_view("false"), std::string_view("null")}) {
+            if (static_cast<size_t>(end - p) >= word.size() && std::memcmp(p, word.data(), word.size()) == 0) {
+                p += word.size();
+                return word;
+            }
+        }
+        fail("unexpected token");
+    }
+
+    // Compact text of any value, as nlohmann's dump() would write it for
+    // literals, integers, arrays and objects
+    std::string dump() {
+        char c = peek();
+        if (c == '"') {
+            const char* start = p;
+            skipValue();
+            return std::string(start, p - start);
+        }
+        if (c == 't' || c == 'f' || c == 'n') return std::string(literal());
+        if (c != '{' && c != '[') return std::string(number());
+
+        const char* start = p;
+        skipValue();
+        std::string out;
+        bool inString = false;
+        for (const char* q = start; q < p; ++q) {
+            if (inString) {
+                out += *q;
+                if (*q == '\\') out += *++q;
+                else if (*q == '"') inString = false;
+            } else if (*q == '"') {
+                inString = true;
+                out += *q;
+            } else if (*q != ' ' && *q != '\n' && *q != '\r' && *q != '\t') {
+                out += *q;
+            }
+        }
+        return out;
+    }
+
+    bool atEnd() {
+        return peek() == '\0' && p == end;
+    }
+};
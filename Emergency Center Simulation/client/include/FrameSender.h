@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ConnectionHandler.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// The only writer of the session socket. Command handlers queue encoded
+// frames and return; the sender thread takes everything queued, up to
+// MAX_WRITE_BYTES, and writes it with one call, so a burst of SEND frames
+// costs a handful of syscalls and never waits on the keyboard thread.
+//
+// The queue is bounded by capacity bytes. send() blocks while it is full,
+// which pushes back on a producer that outruns the server; it records the
+// wait in Metrics::SendQueueWait and says so on the console, once until the
+// queue next runs empty.
+//
+// While the connection is down (connectionLost until setConnection) nothing
+// is written. Frames queued with holdWhileDown stay queued in order and go
+// out on the new connection; the others are dropped. A full queue does not
+// drain then, so send() stops waiting for room and leaves it to the caller
+// to wait for the new connection.
+class FrameSender {
+private:
+    struct Item {
+        std::string frame;
+        bool holdWhileDown;
+        std::string note; // printed once the frame is written
+        bool heartBeat;   // a lone newline instead of frame
+    };
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Item> queue;
+    size_t queuedBytes;
+    size_t capacity;
+    ConnectionHandler* connection; // not owned
+    bool down;
+    bool writing;
+    bool stopping;
+    bool fullReported;
+    std::thread thread;
+
+    void run();
+    void dropUnheld();
+
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 64 << 20;
+    static constexpr size_t MAX_WRITE_BYTES = 64 << 10;
+
+    explicit FrameSender(size_t capacity = DEFAULT_CAPACITY);
+    ~FrameSender();
+    FrameSender(const FrameSender&) = delete;
+    FrameSender& operator=(const FrameSender&) = delete;
+
+    // Starts the sender thread writing to connection, with an empty queue
+    void start(ConnectionHandler* connection);
+    // Stops the thread after writing what is queued, unless the connection is down
+    void stop();
+
+    // Queues frame (without its '\0' delimiter). Blocks while the queue is full.
+    // Returns false, leaving frame and note as they were, if the sender is not running or if the
+    // queue is full while the connection is down; the caller may try again after waitForConnection.
+    bool send(std::string&& frame, bool holdWhileDown, std::string&& note = std::string());
+    // Blocks while the connection is down. Returns false if the sender stopped instead.
+    bool waitForConnection();
+
+    // Queues a heart-beat newline unless anything is queued or being written anyway.
+    // Returns true if one was queued.
+    bool sendHeartBeat();
+
+    // Marks the connection down and shuts its socket down, so the reader notices too
+    void connectionLost();
+    // Writes to connection from now on, once any write still in flight has returned
+    void setConnection(ConnectionHandler* connection);
+    bool isDown();
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ConnectionHandler.h"
+#include "FrameSender.h"
+#include "TimerWheel.h"
+#include <chrono>
+#include <string>
+
+// STOMP 1.2 heart-beating for one session. The client offers its intervals in
+// the CONNECT heart-beat header; start() takes the server's CONNECTED header
+// and runs what both sides can do, on the process-wide TimerWheel:
+//
+//  - outgoing: when nothing was written for the send interval, a newline is
+//    queued on the FrameSender, so any other traffic suppresses the ping;
+//  - incoming: when nothing at all was read for RECEIVE_GRACE server intervals,
+//    the connection is shut down, which makes the reader reconnect.
+//
+// Activity is read from the timestamps ConnectionHandler keeps, so the socket
+// paths never touch the wheel. A server that answers without a heart-beat
+// header, like the bundled one, disables both directions.
+class HeartBeat {
+private:
+    TimerWheel& wheel;
+    TimerWheel::Timer sendTimer;
+    TimerWheel::Timer receiveTimer;
+    // Set by start, read by the timer callbacks
+    ConnectionHandler* connection; // not owned
+    FrameSender* sender;           // not owned
+    std::chrono::milliseconds sendInterval;
+    std::chrono::milliseconds receiveInterval;
+
+    std::chrono::milliseconds onSendTimer();
+    std::chrono::milliseconds onReceiveTimer();
+
+public:
+    static constexpr double RECEIVE_GRACE = 1.5;
+
+    explicit HeartBeat(TimerWheel& wheel = TimerWheel::instance());
+    ~HeartBeat();
+    HeartBeat(const HeartBeat&) = delete;
+    HeartBeat& operator=(const HeartBeat&) = delete;
+
+    // The CONNECT header line offering to send every send and to receive every receive; zero means never
+    static std::string offer(std::chrono::milliseconds send, std::chrono::milliseconds receive);
+
+    // Negotiates against serverHeader, the value of the CONNECTED heart-beat header, and starts
+    // the timers for connection. send and receive must be what the CONNECT frame offered.
+    void start(ConnectionHandler* connection, FrameSender& sender, std::chrono::milliseconds send,
+               std::chrono::milliseconds receive, const std::string& serverHeader);
+    // Stops both timers; once it returns no callback uses the connection any more
+    void stop();
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "Trace.h"
+
+// Process-wide counters and latency histograms for the client hot paths.
+//
+// Every thread records into its own shard, so recording is a couple of relaxed
+// loads and stores with no locks and no shared cache lines. The registry lock is
+// only taken the first time a thread records and when a snapshot is taken.
+// Histograms are log-linear: 8 linear sub-buckets per power of two, which keeps
+// every percentile within 12.5% of the true value.
+class Metrics {
+public:
+    enum Counter {
+        FramesReceived,
+        FramesSent,
+        BytesReceived,
+        BytesSent,
+        SocketReads,
+        SocketWrites,
+        ReportsStored,
+        Reconnects,
+        FramesHeld,
+        HeartBeatsSent,
+        HeartBeatTimeouts,
+        COUNTER_COUNT
+    };
+
+    enum Histogram {
+        ParseTime,          // StompProtocol::handleFrame, up to dispatching the command
+        StoreTime,          // StompProtocol::applyReports, once per batch of received reports
+        ProtocolLockWait,   // waiting for StompProtocol::protocolMutex
+        SharedDataLockWait, // waiting for StompClient::sharedDataMutex
+        CommandTime,        // a keyboard command from input to completion
+        EventFileParseTime, // parseEventsFile and encoding the bodies, for a report the cache missed
+        ReportSendTime,     // building and queueing the SEND frames of report / generate
+        SendQueueWait,      // a producer blocked on a full FrameSender queue
+        HISTOGRAM_COUNT
+    };
+
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    struct HistogramSnapshot {
+        uint64_t count;
+        uint64_t sum;
+        uint64_t buckets[BUCKET_COUNT];
+        // Upper bound of the bucket holding the given quantile (0..1)
+        uint64_t percentile(double quantile) const;
+    };
+
+    struct Snapshot {
+        uint64_t counters[COUNTER_COUNT];
+        HistogramSnapshot histograms[HISTOGRAM_COUNT];
+    };
+
+    static void increment(Counter counter, uint64_t amount = 1);
+    static void record(Histogram histogram, uint64_t nanos);
+
+    // Monotonic clock in nanoseconds
+    static uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Lock mutex and record how long the caller waited for it, also as a trace span
+    template <typename Mutex>
+    static std::unique_lock<Mutex> timedLock(Mutex& mutex, Histogram histogram) {
+        uint64_t start = now();
+        std::unique_lock<Mutex> lock(mutex);
+        uint64_t end = now();
+        record(histogram, end - start);
+        if (Trace::enabled()) Trace::record(name(histogram), start, end);
+        return lock;
+    }
+
+    static const char* name(Counter counter);
+    static const char* name(Histogram histogram);
+
+    // Sum over every thread's shard
+    static Snapshot snapshot();
+    // Human readable dump of a snapshot, one metric per line
+    static std::string format(const Snapshot& snapshot);
+
+    static int bucketOf(uint64_t value);
+    static uint64_t bucketUpperBound(int bucket);
+
+private:
+    struct Shard;
+    struct ShardLease;
+    static std::mutex registryMutex;
+    static std::vector<std::unique_ptr<Shard>>& registry();
+    static std::vector<Shard*>& freeShards();
+    static Shard& retired();
+    static Shard& localShard();
+    static void release(Shard& shard);
+};
+
+// Records the lifetime of the enclosing scope into a histogram
+class ScopedTimer {
+private:
+    Metrics::Histogram histogram;
+    uint64_t start;
+
+public:
+    explicit ScopedTimer(Metrics::Histogram histogram) : histogram(histogram), start(Metrics::now()) {}
+    ~ScopedTimer() { Metrics::record(histogram, Metrics::now() - start); }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
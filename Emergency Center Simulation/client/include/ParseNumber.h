@@ -0,0 +1,19 @@
+#pragma once
+
+#include <charconv>
+#include <string_view>
+
+// Reads all of text as a decimal integer of type T with std::from_chars: no
+// exceptions, no locale, no allocation. Unlike std::stoi and friends it takes no
+// leading whitespace or '+', no trailing characters, and no '-' for an unsigned T.
+// Returns false, leaving value as it was, if text is not such a number or does
+// not fit in T.
+template <typename T>
+bool parseNumber(std::string_view text, T& value) {
+    T parsed{};
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, parsed);
+    if (result.ec != std::errc() || result.ptr != end) return false;
+    value = parsed;
+    return true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "event.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// The report bodies of one events file, encoded once for any user: every body
+// is kept without its "user:<user>" line (see ReportCodec::encodeWithoutUser)
+// and the sender splices the user back in front of it.
+struct EncodedEvents {
+    std::string destination;  // "/" + channel
+    std::string bodies;       // the bodies back to back
+    std::vector<size_t> ends; // where each body ends in bodies
+    EncodedEvents() : destination(""), bodies(), ends() {}
+
+    // Every event goes to data.channel_name, as parseEventsFile and the generator fill it
+    static EncodedEvents encode(const names_and_events& data);
+    size_t size() const { return ends.size(); }
+    std::string_view body(size_t i) const;
+};
+
+// Size and modification time of a file; a cached encoding is only used while they are unchanged
+struct FileStamp {
+    uint64_t size;
+    int64_t modified; // nanoseconds since the epoch
+    FileStamp() : size(0), modified(0) {}
+    bool operator==(const FileStamp& other) const { return size == other.size && modified == other.modified; }
+};
+
+// Encoded events files by path, so a report of a file that has not changed
+// since it was last reported skips parsing and encoding and goes straight to
+// the socket.
+//
+// Entries are kept in memory up to a byte budget, least recently used out
+// first. With a directory set, every entry is also written there, one file per
+// path, and a memory miss looks there before the caller parses; a later run
+// then starts warm. A cache file that does not match the path and stamp, or is
+// damaged, is a miss.
+//
+// Not synchronised; StompClient uses it under sharedDataMutex.
+class ReportCache {
+public:
+    static constexpr size_t DEFAULT_MAX_BYTES = size_t(64) << 20;
+
+    ReportCache();
+
+    // Fills stamp from the file at path; false if it cannot be stat'ed
+    static bool stamp(const std::string& path, FileStamp& stamp);
+
+    // The encoding of path taken at stamp, nullptr on a miss. Valid until the next find, insert or clear.
+    const EncodedEvents* find(const std::string& path, const FileStamp& stamp);
+    // Caches the encoding of path, parsed after stamp was taken. Returns the cached copy, or
+    // nullptr, leaving events as it was, when it is larger than the whole memory budget.
+    const EncodedEvents* insert(const std::string& path, const FileStamp& stamp, EncodedEvents&& events);
+    // Drops the entries in memory; those in the directory stay and still hit
+    void clear();
+
+    // Persist entries under directory, creating it if needed; empty keeps them in memory only
+    bool setDirectory(const std::string& directory);
+    const std::string& getDirectory() const { return directory; }
+
+    size_t entries() const { return cache.size(); }
+    size_t bytes() const { return totalBytes; }
+    uint64_t hits() const { return hitCount; }
+    uint64_t misses() const { return missCount; }
+
+private:
+    struct Entry {
+        FileStamp stamp;
+        EncodedEvents events;
+        size_t bytes;
+        uint64_t lastUse;
+        Entry() : stamp(), events(), bytes(0), lastUse(0) {}
+    };
+
+    std::unordered_map<std::string, Entry> cache;
+    size_t maxBytes;
+    size_t totalBytes;
+    uint64_t useClock;
+    uint64_t hitCount;
+    uint64_t missCount;
+    std::string directory;
+
+    const EncodedEvents* store(const std::string& path, const FileStamp& stamp, EncodedEvents&& events);
+    std::string fileFor(const std::string& path) const;
+    bool load(const std::string& path, const FileStamp& stamp, EncodedEvents& events) const;
+    void save(const std::string& path, const FileStamp& stamp, const EncodedEvents& events) const;
+};
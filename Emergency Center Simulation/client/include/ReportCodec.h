@@ -0,0 +1,42 @@
+#pragma once
+
+#include "event.h"
+#include "ReportStore.h"
+#include <string>
+#include <string_view>
+
+// The body of a report SEND / MESSAGE frame, written by the reporting client
+// and read back by every subscriber:
+//
+//   user:<user>
+//   city:<city>
+//   event name:<event name>
+//   date time:<epoch seconds>
+//   general information:
+//           <key>:<value>          (one line per entry)
+//   description:
+//   <description>
+//
+// Decoding trims every line and splits it at its first ':', so values may
+// contain colons. Every keyed line between "general information" and
+// "description" is a detail, whatever its key. Everything after the
+// "description:" line is the description; its lines are trimmed, empty ones
+// dropped and the rest joined with single spaces (the server drops empty
+// lines and trims the body anyway, so that is what survives the trip).
+// The channel is not part of the body, it travels in the destination header.
+class ReportCodec {
+public:
+    // Append the body for event, reported by user, to out
+    static void encode(const std::string& user, const Event& event, std::string& out);
+    // Append the body for event less its leading "user:<user>" line, from the newline
+    // that ends it; "user:" + user + this is what encode appends
+    static void encodeWithoutUser(const Event& event, std::string& out);
+
+    // Fill report from body. Returns false, leaving report partly filled, if
+    // the body has no user or its date time is not a number.
+    static bool decode(std::string_view body, Report& report);
+
+    // Fill header from body, reading no further than the "description:" line and keeping
+    // only the details ReportHeader has; its user and city are offsets into body. Fails like decode.
+    static bool scan(std::string_view body, ReportHeader& header);
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "DetailValue.h"
+#include "RingBuffer.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <deque>
+
+struct Report {
+    std::string user;
+    std::string eventName;
+    std::string city;
+    long dateTime; // Unix timestamp
+    std::string description;
+    std::map<std::string, DetailValue> details; // Holds key-value pairs like "active", "forces_arrival_at_scene", etc.
+    Report()
+        : user(""), eventName(""), city(""), dateTime(0), description(""), details() {}};
+
+// What ReportCodec::scan reads from a body without decoding the rest: enough to
+// index a report kept raw and to answer the common filters on it. User and city
+// are left where they are in the body, so the header is a fixed-size record.
+struct ReportHeader {
+    uint32_t userOffset; // the user is body[userOffset, userOffset + userLength)
+    uint32_t userLength;
+    uint32_t cityOffset; // the city is body[cityOffset, cityOffset + cityLength)
+    uint32_t cityLength;
+    long dateTime;
+    bool active;        // the "active" detail is true
+    bool forcesArrived; // the "forces_arrival_at_scene" detail is true
+    ReportHeader()
+        : userOffset(0), userLength(0), cityOffset(0), cityLength(0), dateTime(0), active(false), forcesArrived(false) {}
+
+    std::string_view user(std::string_view body) const { return body.substr(userOffset, userLength); }
+    std::string_view city(std::string_view body) const { return body.substr(cityOffset, cityLength); }
+};
+
+// A report still in its encoded form (see ReportCodec.h)
+struct RawReport {
+    ReportHeader header;
+    std::string_view body;
+    RawReport() : header(), body() {}
+};
+
+// Filter for ReportStore::query. Empty strings and an empty details map match everything.
+struct ReportQuery {
+    std::string user;
+    std::string city;
+    std::string eventName;
+    long from; // inclusive
+    long to;   // inclusive
+    std::map<std::string, DetailValue> details; // Detail key -> required value, e.g. "active" -> true; kinds must match too
+    ReportQuery();
+};
+
+// How much history a channel keeps. A limit of 0 means unlimited.
+struct RetentionPolicy {
+    size_t maxReports;
+    long maxAgeSeconds; // measured from when the report was received
+    size_t maxBytes;
+    RetentionPolicy() : maxReports(0), maxAgeSeconds(0), maxBytes(0) {}
+};
+
+struct ReportStoreUsage {
+    size_t reports;
+    size_t bytes;   // estimated heap footprint of the stored reports and their index entries
+    size_t evicted; // reports dropped by the retention policy so far
+    ReportStoreUsage() : reports(0), bytes(0), evicted(0) {}
+};
+
+// The reports received on one channel. Besides the reports themselves the store
+// keeps secondary indexes (a dateTime-sorted array and per-user / per-city
+// posting lists) so a query only visits the smallest matching candidate set.
+//
+// Reports live in a ring buffer and are addressed by a sequence number that
+// grows with every add, so evicting the oldest report under the retention
+// policy is O(1): the posting lists are in sequence order and lose their front
+// entry, and stale entries in the time index are skipped until enough of them
+// pile up to be worth compacting.
+//
+// Every report is a fixed-size StoredReport. One added raw is only that and its
+// body, copied into an arena of ARENA_CHUNK_SIZE chunks and decoded when a
+// query needs more than the record, or returns it. Chunks are freed in order as
+// the reports in them are evicted. A report added decoded also keeps its Report
+// in a second ring, evicted in step with the records.
+class ReportStore {
+private:
+    struct StoredReport {
+        // Set for every report, so indexing and the header filters never decode
+        const std::string* user; // key in byUser
+        const std::string* city; // key in byCity
+        long dateTime;
+        long receivedAt;
+        size_t bytes;
+        bool raw;
+        bool active;        // raw reports only, see ReportHeader
+        bool forcesArrived; // raw reports only
+        size_t chunk;  // raw body: sequence number of its arena chunk; decoded: sequence number in decoded
+        size_t offset; // raw body: where in that chunk
+        size_t length;
+        StoredReport()
+            : user(nullptr), city(nullptr), dateTime(0), receivedAt(0), bytes(0), raw(false), active(false),
+              forcesArrived(false), chunk(0), offset(0), length(0) {}
+        StoredReport(const StoredReport& other) = default;
+        StoredReport& operator=(const StoredReport& other) = default;
+    };
+
+    RingBuffer<StoredReport> reports;
+    size_t firstSeq; // sequence number of reports.front()
+    RingBuffer<Report> decoded; // the reports added decoded, in sequence order
+    size_t firstDecoded; // sequence number of decoded.front()
+    std::vector<std::pair<long, size_t>> byTime; // (dateTime, seq), sorted by dateTime; may hold evicted seqs
+    size_t staleTimeEntries;
+    std::unordered_map<std::string, std::deque<size_t>> byUser;
+    std::unordered_map<std::string, std::deque<size_t>> byCity;
+    std::deque<std::string> arena; // raw bodies in sequence order
+    size_t firstChunk; // sequence number of arena.front()
+    std::string indexKey; // a user or city being looked up in byUser / byCity
+    RetentionPolicy retention;
+    size_t bytes;
+    size_t evicted;
+
+    // Whether stored matches query; decodes a raw report into scratch when a filter needs more than its header
+    bool matches(const StoredReport& stored, const ReportQuery& query, Report& scratch) const;
+    bool decode(const StoredReport& stored, Report& report) const;
+    const Report& decodedReport(const StoredReport& stored) const;
+    const StoredReport& at(size_t seq) const;
+    void evictOldest();
+    // Store a report and index it by user and city; the caller indexes it by time
+    void append(Report report, long now);
+    void append(const RawReport& raw, long now);
+    void insert(StoredReport& stored, std::string_view user, std::string_view city, long now);
+    template <typename T>
+    void addBatch(std::vector<T>& batch, long now);
+    static size_t footprint(const Report& report);
+
+public:
+    static constexpr size_t ARENA_CHUNK_SIZE = 64 << 10;
+
+    ReportStore();
+    void add(Report report, long now);
+    // Adds every report of batch in order, as that many add calls would, and leaves it empty.
+    // The time index takes the batch sorted in one merge instead of an insert per report.
+    void add(std::vector<Report>& batch, long now);
+    // The same for reports kept raw; the bodies are copied
+    void add(std::vector<RawReport>& batch, long now);
+    // Drop reports that no longer fit the retention policy
+    void enforceRetention(long now);
+    void setRetention(const RetentionPolicy& policy, long now);
+    // Matching reports ordered by dateTime
+    std::vector<Report> query(const ReportQuery& query) const;
+    std::vector<std::string> users() const;
+    size_t size() const;
+    ReportStoreUsage usage() const;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+// FIFO buffer over a contiguous slot array. Pushing and popping are O(1);
+// the slot array doubles when a push finds it full, so a caller that keeps
+// the size bounded never reallocates once that bound has been reached.
+template <typename T>
+class RingBuffer {
+private:
+    std::vector<T> slots;
+    size_t head;
+    size_t count;
+
+    void grow(size_t capacity) {
+        std::vector<T> larger(capacity);
+        for (size_t i = 0; i < count; ++i) {
+            larger[i] = std::move(slots[(head + i) % slots.size()]);
+        }
+        slots.swap(larger);
+        head = 0;
+    }
+
+public:
+    RingBuffer() : slots(), head(0), count(0) {}
+
+    void push_back(T value) {
+        if (count == slots.size()) grow(slots.empty() ? 16 : slots.size() * 2);
+        slots[(head + count) % slots.size()] = std::move(value);
+        ++count;
+    }
+
+    // Makes room for capacity elements at once, still doubling so repeated reserves stay amortised O(1)
+    void reserve(size_t capacity) {
+        if (capacity <= slots.size()) return;
+        size_t doubled = slots.empty() ? 16 : slots.size() * 2;
+        grow(capacity > doubled ? capacity : doubled);
+    }
+
+    // Drops the oldest element and releases whatever it owns.
+    void pop_front() {
+        slots[head] = T();
+        head = (head + 1) % slots.size();
+        --count;
+    }
+
+    T& front() { return slots[head]; }
+    const T& front() const { return slots[head]; }
+
+    // i-th element counting from the oldest
+    T& operator[](size_t i) { return slots[(head + i) % slots.size()]; }
+    const T& operator[](size_t i) const { return slots[(head + i) % slots.size()]; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t capacity() const { return slots.size(); }
+};
@@ -3,6 +3,12 @@
 #define STOMP_CLIENT_H
 #include "ConnectionHandler.h"
 #include "StompProtocol.h"
+#include "DateFormatter.h"
+#include "EventGenerator.h"
+#include "BodyCompression.h"
+#include "FrameSender.h"
+#include "HeartBeat.h"
+#include "ReportCache.h"
 #include <thread>
 #include <queue>
 #include <mutex>
@@ -18,13 +24,76 @@ private:
     std::thread serverThread;
     std::mutex mutex;
     std::mutex sharedDataMutex; // Protect shared data
+    DateFormatter dateFormatter;
+    // Periodic metrics dump started by "stats dump"
+    std::thread statsThread;
+    std::mutex statsMutex;
+    std::condition_variable statsCondition;
+    bool statsRunning;
+    // Receipt requested by the last command, -1 if none; batch mode waits for it
+    int lastReceiptId;
+    static constexpr std::chrono::milliseconds BATCH_ACK_TIMEOUT{10000};
+    // Report bodies are deflated when "compress on" (see BodyCompression.h)
+    bool compressBodies;
+    // Whether the server hands content-encoding on to subscribers. The server sources do, but the
+    // bundled server/target/StompServer.jar predates that and would pass deflated bodies on as
+    // plain reports; "compress on" is refused until the jar is rebuilt and this is set.
+    static constexpr bool SERVER_FORWARDS_CONTENT_ENCODING = false;
+    BodyCompressor bodyCompressor;
+    // Received reports are kept raw when "lazy on"; applied to every session's protocol
+    bool lazyReports;
+    // Encoded events files, so "report" of an unchanged file skips parsing ("cache")
+    bool cacheReports;
+    ReportCache reportCache;
+    // Connection recovery, driven by the reader thread (see reconnect). Guarded by sharedDataMutex.
+    std::string host;
+    short port;
+    std::string passcode;
+    SocketOptions socketOptions; // Set by "socket", used by every connection opened after that
+    ConnectionHandler* standbyConnection; // Connected but idle socket to fail over to
+    ConnectionHandler* connectionAttempt; // Connection being logged in by reconnect, so logout can abort it
+    std::condition_variable reconnectCondition; // Cuts the backoff sleep short on logout
+    // Writes every frame after CONNECT; also holds SEND frames while the connection is down
+    FrameSender sender;
+    // Heart-beat intervals offered in CONNECT, set by "heartbeat"; zero disables a direction
+    std::chrono::milliseconds heartBeatSend;
+    std::chrono::milliseconds heartBeatReceive;
+    HeartBeat heartBeat;
+    static constexpr std::chrono::milliseconds DEFAULT_HEART_BEAT{10000};
+    static constexpr std::chrono::milliseconds RECONNECT_INITIAL_DELAY{100};
+    static constexpr std::chrono::milliseconds RECONNECT_MAX_DELAY{5000};
+    // Most frames the reader hands to the protocol at once
+    static constexpr size_t MAX_RECEIVE_BATCH = 256;
 
-    void handleLogin(const std::vector<std::string>& args);
-    void handleLogout();
-    void handleJoin(const std::vector<std::string>& args);
-    void handleExit(const std::vector<std::string>& args);
-    void handleReport(const std::vector<std::string>& args);
-    void handleSummary(const std::vector<std::string>& args);
+    bool execute(const std::string& input);
+    std::string connectFrame() const;
+    bool reconnect();
+    ConnectionHandler* newConnection() const;
+    void openStandby();
+    void releaseConnections();
+
+    bool handleLogin(const std::vector<std::string>& args);
+    bool handleLogout();
+    bool handleJoin(const std::vector<std::string>& args);
+    bool handleExit(const std::vector<std::string>& args);
+    bool handleReport(const std::vector<std::string>& args);
+    bool handleGenerate(const std::vector<std::string>& args);
+    bool sendEvents(const EncodedEvents& events, std::unique_lock<std::mutex>& lock);
+    bool handleSummary(const std::vector<std::string>& args);
+    bool handleSummaryAll(const std::vector<std::string>& args);
+    bool handleQuery(const std::vector<std::string>& args);
+    bool handleRetention(const std::vector<std::string>& args);
+    bool handleMemory();
+    bool handleStats(const std::vector<std::string>& args);
+    void stopStatsDump();
+    bool handleTrace(const std::vector<std::string>& args);
+    bool handleCompress(const std::vector<std::string>& args);
+    bool handleLazy(const std::vector<std::string>& args);
+    bool handleCache(const std::vector<std::string>& args);
+    bool handleHeartBeat(const std::vector<std::string>& args);
+    bool handleSocket(const std::vector<std::string>& args);
+    bool parseTimeArg(const std::string& value, bool endOfDay, long& time);
+    bool writeSummary(const std::string& channel, std::vector<Report> reports, const std::string& outputFilePath);
     std::vector<std::string> split(const std::string& input, char delimiter);
     
 public:
@@ -34,6 +103,8 @@ public:
     StompClient& operator=(const StompClient&) = delete;
     std::string epochToDateTime(long epochTime);
     void start();
-    void serverThreadLoop();
+    int runBatch(const std::vector<std::string>& commands);
+    // Reads frames until logout; send and receive are the heart-beat intervals the login CONNECT offered
+    void serverThreadLoop(std::chrono::milliseconds send, std::chrono::milliseconds receive);
     
 };
\ No newline at end of file
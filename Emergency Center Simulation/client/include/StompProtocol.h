@@ -1,39 +1,95 @@
 #pragma once
 #include "../include/ConnectionHandler.h"
 #include "event.h"
+#include "ReportStore.h"
+#include "BodyCompression.h"
+#include "SubscriptionRegistry.h"
 #include <iostream>
-#include <unordered_set>
 #include <string>
+#include <string_view>
 #include <mutex>
-
-struct Report {
-    std::string eventName;
-    std::string city;
-    long dateTime; // Unix timestamp
-    std::string description;
-    std::map<std::string, std::string> details; // Holds key-value pairs like "active", "forces_arrival_at_scene", etc.
-    Report()
-        : eventName(""), city(""), dateTime(0), description(""), details() {}};
+#include <condition_variable>
+#include <chrono>
+#include <set>
 
 // TODO: implement the STOMP protocol
 class StompProtocol {
 private:
     std::mutex protocolMutex; // Protect shared resources
-    std::map<std::string, std::vector<Report>> reportStorage; // Key: topic:user, Value: list of reports
-    bool loggedIn= true; // Tracks whether the client is logged in
-    std::unordered_set<std::string> joinedTopics;
+    std::map<std::string, ReportStore, std::less<>> reportStorage; // Key: topic, Value: reports of every user on that topic
+    std::map<std::string, RetentionPolicy, std::less<>> retentionPolicies; // Per-topic overrides of defaultRetention
+    RetentionPolicy defaultRetention;
+    std::atomic<bool> loggedIn; // Tracks whether the client is logged in
+    bool connected; // CONNECTED frame received
+    std::set<int> receivedReceipts;
+    std::condition_variable stateChanged; // Signalled on CONNECTED, RECEIPT and logout / ERROR
+    SubscriptionRegistry subscriptions;
+    // Inflates content-encoded MESSAGE bodies; only used by the reader thread
+    BodyDecompressor bodyDecompressor;
+    std::string inflatedBody;
+    std::atomic<bool> lazyParsing; // keep report bodies raw (see ReportStore.h)
+    // MESSAGE reports decoded or scanned but not stored yet, and the run of them going to one store;
+    // reader thread only. Their destinations and raw bodies are copied into pendingText, so a
+    // MESSAGE costs no allocation of its own until it is stored, unless it is decoded.
+    struct PendingReport {
+        uint32_t subscription; // the subscription header, parsed
+        bool subscribed;       // false if it had none, or not a number; then only the topic decides
+        size_t topicOffset;    // the destination is pendingText[topicOffset, topicOffset + topicLength)
+        size_t topicLength;
+        bool raw;
+        size_t report;       // decoded: index in pendingDecoded
+        ReportHeader header; // raw: of the body pendingText[bodyOffset, bodyOffset + bodyLength)
+        size_t bodyOffset;
+        size_t bodyLength;
+        PendingReport()
+            : subscription(0), subscribed(false), topicOffset(0), topicLength(0), raw(false), report(0), header(),
+              bodyOffset(0), bodyLength(0) {}
+    };
+    std::vector<PendingReport> pendingReports;
+    std::vector<Report> pendingDecoded;
+    std::string pendingText;
+    std::vector<Report> reportBatch;
+    std::vector<RawReport> rawBatch;
+
+    // The store for topic, created with its retention policy on first use. Needs protocolMutex.
+    ReportStore& storeFor(std::string_view topic);
+    // Parses frame and acts on it; a MESSAGE only goes as far as pendingReports
+    void handleFrame(const std::string& frame);
+    // Decodes a report body (see ReportCodec.h) into pendingReports, or only scans it when lazyParsing
+    void queueReport(std::string_view subscription, std::string_view topic, std::string_view body);
+    // Stores pendingReports under one lock, each in the store of the subscription its MESSAGE
+    // named, or under its topic when that is not one of this session's subscriptions
+    void applyReports();
 
 public:
     StompProtocol();
     std::string createFrame(const std::string& command, const std::map<std::string, std::string>& headers = {}, const std::string& body = "");
     void processFrame(const std::string& frame);
-    void storeReport(const std::string& topic, const std::string& user, const std::string& content);
+    // processFrame for each frame in order, storing the reports of all of them at once
+    void processFrames(const std::vector<std::string>& frames);
     std::vector<Report> getReports(const std::string& topic, const std::string& user);
-    void joinTopic(const std::string& topic);
-    void exitTopic(const std::string& topic);
+    // All (topic, user) pairs that have at least one stored report
+    std::vector<std::pair<std::string, std::string>> getReportKeys();
+    // Reports on topic that match every filter in query, ordered by date time
+    std::vector<Report> queryReports(const std::string& topic, const ReportQuery& query);
+    // Limit how many reports are kept for topic; an empty topic sets the default for every topic without its own policy
+    void setRetention(const std::string& topic, const RetentionPolicy& policy);
+    std::map<std::string, ReportStoreUsage> getMemoryUsage();
+    // Keep reports received from now on as raw bodies, decoded only when a summary or query reads them
+    void setLazyParsing(bool lazy);
+    // Returns the subscription id for the SUBSCRIBE frame, or -1 if no more subscriptions fit
+    int joinTopic(const std::string& topic);
+    // Returns the id of the subscription that was dropped, or -1 if topic was not joined
+    int exitTopic(const std::string& topic);
     bool isSubscribed(const std::string& topic);
+    // Snapshot of the joined topics and their subscription ids, for re-subscribing after a reconnect
+    std::vector<std::pair<std::string, int>> getSubscriptions();
     // Check login status
     bool isLoggedIn();
     // Set login status
     void setLoggedIn(bool status);
+    // Block until the server acknowledged the CONNECT frame. Returns false on ERROR, disconnect or timeout.
+    bool waitForConnected(std::chrono::milliseconds timeout);
+    // Block until the RECEIPT for receiptId arrives. Returns false on ERROR, disconnect or timeout.
+    bool waitForReceipt(int receiptId, std::chrono::milliseconds timeout);
 };
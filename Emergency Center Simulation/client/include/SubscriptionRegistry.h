@@ -0,0 +1,54 @@
+#pragma once
+
+#include "ReportStore.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// The subscriptions of one session, in a dense array of slots. The id sent in
+// SUBSCRIBE, and echoed by the server in every MESSAGE subscription header,
+// encodes the slot index and the slot's generation, so routing a MESSAGE is a
+// number parse and an array index rather than a lookup by destination.
+//
+// A slot freed by exit is reused by the next join with its generation bumped;
+// a MESSAGE still in flight for the old subscription then no longer resolves.
+//
+// Not synchronised; StompProtocol guards it with its own mutex.
+class SubscriptionRegistry {
+public:
+    static constexpr int SLOT_BITS = 16;
+    static constexpr uint32_t MAX_SLOTS = uint32_t(1) << SLOT_BITS;
+
+    struct Subscription {
+        std::string destination;
+        ReportStore* store; // not owned; where MESSAGE bodies for this subscription go
+        uint32_t generation;
+        bool active;
+        Subscription() : destination(""), store(nullptr), generation(0), active(false) {}
+        Subscription(const Subscription& other) = default;
+        Subscription& operator=(const Subscription& other) = default;
+        Subscription(Subscription&& other) = default;
+        Subscription& operator=(Subscription&& other) = default;
+    };
+
+    SubscriptionRegistry();
+
+    // Subscribes to destination and returns the id for the SUBSCRIBE frame, or -1 when every slot is taken
+    int add(const std::string& destination, ReportStore* store);
+    // Unsubscribes from destination and returns the id it had, or -1 if it was not subscribed
+    int remove(const std::string& destination);
+    // The id of the subscription to destination, or -1
+    int find(const std::string& destination) const;
+    // The active subscription a MESSAGE subscription header, parsed, refers to; nullptr if none
+    Subscription* resolve(uint32_t id);
+    // (destination, id) of every active subscription, for re-subscribing after a reconnect
+    std::vector<std::pair<std::string, int>> active() const;
+
+private:
+    std::vector<Subscription> slots;
+    std::vector<uint32_t> freeSlots;
+
+    static int idOf(uint32_t slot, uint32_t generation);
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Hierarchical timer wheel shared by every session in the process.
+//
+// LEVELS wheels of SLOTS slots each; a slot of level n spans SLOTS^n ticks of
+// TICK. A timer goes into the lowest level whose range covers its delay and is
+// moved down a level ("cascaded") when the wheel above turns over, so
+// scheduling and cancelling are O(1) list operations whatever the number of
+// timers. One "timers" thread advances the wheel while anything is scheduled
+// and sleeps otherwise; callbacks run on that thread and must be short.
+//
+// Timers are intrusive: the owner keeps the Timer and must cancel it before
+// destroying it.
+class TimerWheel {
+public:
+    static constexpr std::chrono::milliseconds TICK{10};
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+    static constexpr int LEVELS = 4; // 64^4 ticks of 10 ms, about 1.9 days
+
+    class Timer {
+    public:
+        // Returns the delay until the next run, or zero to stop
+        explicit Timer(std::function<std::chrono::milliseconds()> callback);
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+    private:
+        friend class TimerWheel;
+        std::function<std::chrono::milliseconds()> callback;
+        Timer* prev;
+        Timer* next;
+        Timer** slot; // list the timer is linked into, nullptr if not scheduled
+        uint64_t expires; // tick
+    };
+
+    static TimerWheel& instance();
+
+    TimerWheel();
+    ~TimerWheel();
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // Runs timer's callback after delay, to within a tick. Reschedules a scheduled timer.
+    void schedule(Timer& timer, std::chrono::milliseconds delay);
+    // Unschedules timer; if its callback is running, waits for it to return first.
+    // Must not be called from the timer's own callback.
+    void cancel(Timer& timer);
+
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    Timer* slots[LEVELS][SLOTS];
+    uint64_t current; // last tick processed
+    std::chrono::steady_clock::time_point epoch; // time of tick 0
+    size_t scheduled;
+    Timer* running; // timer whose callback is running, if any
+    bool stopping;
+    std::thread thread;
+
+    void link(Timer& timer);
+    void unlink(Timer& timer);
+    void advance(std::unique_lock<std::mutex>& lock);
+    void run();
+};
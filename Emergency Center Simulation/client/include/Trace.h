@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <memory>
+#include <vector>
+
+// Optional per-span tracing that can be written out as Chrome trace-event JSON
+// and opened in Perfetto or chrome://tracing.
+//
+// Each thread appends completed spans to its own fixed-size buffer and
+// publishes them with a release store of the event count, so recording takes
+// no locks. The event storage is only allocated on a thread's first span, and a
+// buffer goes back to a pool when its thread exits; its spans stay in the trace
+// and the next thread to start takes over the buffer and its tid. While tracing is stopped a span costs one relaxed load. Span names
+// must outlive the trace: pass string literals.
+class Trace {
+public:
+    static constexpr size_t EVENTS_PER_THREAD = 1 << 16;
+
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+
+    // Begin a new trace, discarding whatever the previous one recorded
+    static void start();
+    // Stop recording and write the trace to path. Returns false if the file cannot be written.
+    static bool stop(const std::string& path);
+
+    static void record(const char* name, uint64_t startNanos, uint64_t endNanos);
+    // Label the calling thread in the trace viewer
+    static void setThreadName(const char* name);
+
+private:
+    struct Event {
+        const char* name;
+        uint64_t start;
+        uint64_t end;
+    };
+    struct ThreadBuffer;
+    struct BufferLease;
+
+    static std::atomic<bool> active;
+    static std::atomic<uint32_t> generation;
+    static uint64_t origin;
+    static std::mutex registryMutex;
+    static std::vector<std::unique_ptr<ThreadBuffer>>& registry();
+    static std::vector<ThreadBuffer*>& freeBuffers();
+    static ThreadBuffer& localBuffer();
+};
+
+// Records the lifetime of the enclosing scope as a span while tracing is on
+class TraceSpan {
+private:
+    const char* name;
+    uint64_t start;
+
+public:
+    explicit TraceSpan(const char* name);
+    ~TraceSpan();
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
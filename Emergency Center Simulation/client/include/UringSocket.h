@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// io_uring send and receive for a connected socket, used by ConnectionHandler
+// when SocketOptions::ioUring is set. Talks to the kernel through the raw
+// syscalls and <linux/io_uring.h>, so it needs no library; open() fails on
+// kernels without provided buffer rings (Linux 5.19) and the caller falls back
+// to asio.
+//
+// Receiving keeps one multishot RECV armed over BUFFER_COUNT buffers registered
+// with the kernel as a provided buffer ring. Incoming data lands in whichever
+// buffer is free and receive() copies out of them, so a burst of frames costs
+// one io_uring_enter instead of a read per chunk. A buffer goes back to the
+// ring once it has been copied out.
+//
+// Sending submits one SEND with MSG_WAITALL, or a frame and its delimiter as
+// two linked SENDs, and waits for them in the same io_uring_enter.
+//
+// The socket is registered as a fixed file. Each direction has its own ring:
+// the receive ring belongs to the reader thread (the first to call receive),
+// the send ring is shared under a mutex by whoever writes.
+class UringSocket {
+public:
+    static constexpr unsigned BUFFER_COUNT = 16; // a power of two
+    static constexpr unsigned BUFFER_SIZE = 16 << 10;
+
+    // nullptr, with the reason in error, if io_uring or a feature it needs is unavailable.
+    // quickAck re-arms TCP_QUICKACK after every wait for data, as the asio path does after every read.
+    static std::unique_ptr<UringSocket> open(int fd, bool quickAck, std::string& error);
+    ~UringSocket();
+    UringSocket(const UringSocket&) = delete;
+    UringSocket& operator=(const UringSocket&) = delete;
+
+    // Block until data arrived and copy up to size bytes of it. Returns the count, or 0 on end of
+    // stream (error 0) or with an errno in error.
+    size_t receive(char* bytes, size_t size, int& error);
+    // Block until all bytes were sent. False with an errno in error.
+    bool send(const char* bytes, size_t size, int& error);
+    // Sends first, then second as an operation linked to it
+    bool send(const char* first, size_t firstSize, const char* second, size_t secondSize, int& error);
+
+private:
+    struct Ring;     // one io_uring instance and its mapped queues
+    struct Receiver; // provided buffers and received data not yet copied out
+
+    std::unique_ptr<Ring> receiveRing;
+    std::unique_ptr<Receiver> receiver;
+    std::unique_ptr<Ring> sendRing;
+    std::mutex sendMutex;
+    int fd;
+    bool quickAck;
+
+    UringSocket();
+    bool submitSends(const char* first, size_t firstSize, const char* second, size_t secondSize, int& error);
+};
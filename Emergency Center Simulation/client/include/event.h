@@ -1,5 +1,6 @@
 #pragma once
 
+#include "DetailValue.h"
 #include <string>
 #include <iostream>
 #include <map>
@@ -19,12 +20,19 @@ private:
     // description of the event
     std::string description;
     // map of all the general information
-    std::map<std::string, std::string> general_information;
+    std::map<std::string, DetailValue> general_information;
     std::string eventOwnerUser;
 
 public:
-    Event(std::string channel_name, std::string city, std::string name, int date_time, std::string description, std::map<std::string, std::string> general_information);
+    // Arguments are taken by value and moved into the members, so callers that pass rvalues allocate nothing here
+    Event(std::string channel_name, std::string city, std::string name, int date_time, std::string description, std::map<std::string, DetailValue> general_information);
+    // Decodes a report body with ReportCodec (throws std::runtime_error if malformed); the channel is not in the body, set it with setEventChannelName
     Event(const std::string & frame_body);
+    // Declared explicitly: the virtual destructor would otherwise suppress the moves and make vector<Event> copy on growth
+    Event(const Event &other) = default;
+    Event(Event &&other) = default;
+    Event &operator=(const Event &other) = default;
+    Event &operator=(Event &&other) = default;
     virtual ~Event();
     void setEventOwnerUser(std::string setEventOwnerUser);
     const std::string &getEventOwnerUser() const;
@@ -33,7 +41,7 @@ public:
     const std::string &get_description() const;
     const std::string &get_name() const;
     int get_date_time() const;
-    const std::map<std::string, std::string> &get_general_information() const;
+    const std::map<std::string, DetailValue> &get_general_information() const;
     void split_str(const std::string &input, char delimiter, std::vector<std::string> &output);
     void setEventChannelName(std::string channelName);
 
@@ -45,5 +53,5 @@ struct names_and_events {
     std::vector<Event> events;
 };
 
-// function that parses the json file and returns a names_and_events object
+// function that parses the json file (or a binary events file, see BinaryEventFile.h) and returns a names_and_events object
 names_and_events parseEventsFile(std::string json_path);
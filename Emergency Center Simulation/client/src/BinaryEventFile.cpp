@@ -0,0 +1,225 @@
+#include "../include/BinaryEventFile.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+void putU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+void putU8(std::string& out, uint8_t value) {
+    out.push_back(static_cast<char>(value));
+}
+
+void putI64(std::string& out, int64_t value) {
+    uint64_t bits = static_cast<uint64_t>(value);
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+}
+
+// Interns strings into the table as the events are encoded
+class StringTable {
+private:
+    std::unordered_map<std::string, uint32_t> indexes;
+    std::vector<const std::string*> strings;
+
+public:
+    StringTable() : indexes(), strings() {}
+
+    uint32_t add(const std::string& value) {
+        auto inserted = indexes.emplace(value, static_cast<uint32_t>(strings.size()));
+        if (inserted.second) strings.push_back(&inserted.first->first);
+        return inserted.first->second;
+    }
+
+    void write(std::string& out) const {
+        for (const std::string* value : strings) {
+            putU32(out, static_cast<uint32_t>(value->size()));
+            out.append(*value);
+        }
+    }
+
+    size_t size() const { return strings.size(); }
+};
+
+// Bounds-checked little-endian reader over the mapped file
+class Reader {
+private:
+    const unsigned char* data;
+    size_t size;
+    size_t pos;
+
+    void need(size_t bytes) {
+        if (size - pos < bytes) throw std::runtime_error("Binary events file is truncated");
+    }
+
+public:
+    Reader(const void* data, size_t size) : data(static_cast<const unsigned char*>(data)), size(size), pos(0) {}
+
+    uint8_t u8() {
+        need(1);
+        return data[pos++];
+    }
+
+    uint32_t u32() {
+        need(4);
+        uint32_t value = uint32_t(data[pos]) | uint32_t(data[pos + 1]) << 8 |
+                         uint32_t(data[pos + 2]) << 16 | uint32_t(data[pos + 3]) << 24;
+        pos += 4;
+        return value;
+    }
+
+    int64_t i64() {
+        uint64_t low = u32();
+        uint64_t high = u32();
+        return static_cast<int64_t>(low | high << 32);
+    }
+
+    std::string_view bytes(size_t length) {
+        need(length);
+        std::string_view view(reinterpret_cast<const char*>(data + pos), length);
+        pos += length;
+        return view;
+    }
+};
+
+// Unmaps on scope exit, including when a malformed file throws
+struct MappedFile {
+    void* data;
+    size_t size;
+    MappedFile(void* data, size_t size) : data(data), size(size) {}
+    ~MappedFile() { if (data != MAP_FAILED) munmap(data, size); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
+
+} // namespace
+
+bool isBinaryEventsFile(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    char magic[sizeof(BINARY_EVENTS_MAGIC)];
+    return f.read(magic, sizeof(magic)) && std::memcmp(magic, BINARY_EVENTS_MAGIC, sizeof(magic)) == 0;
+}
+
+bool writeBinaryEventsFile(const names_and_events& data, const std::string& path) {
+    StringTable table;
+    std::string events;
+    uint32_t channel = table.add(data.channel_name);
+    for (const Event& event : data.events) {
+        putU32(events, table.add(event.get_name()));
+        putU32(events, table.add(event.get_city()));
+        putI64(events, event.get_date_time());
+        putU32(events, table.add(event.get_description()));
+        putU32(events, static_cast<uint32_t>(event.get_general_information().size()));
+        for (const auto& [key, value] : event.get_general_information()) {
+            putU32(events, table.add(key));
+            putU8(events, value.kind());
+            switch (value.kind()) {
+                case DetailValue::Bool: putU8(events, value.asBool() ? 1 : 0); break;
+                case DetailValue::Int: putI64(events, value.asInt()); break;
+                case DetailValue::Double: {
+                    double decimal = value.asDouble();
+                    int64_t bits;
+                    std::memcpy(&bits, &decimal, sizeof(bits));
+                    putI64(events, bits);
+                    break;
+                }
+                case DetailValue::String: putU32(events, table.add(value.asString())); break;
+            }
+        }
+    }
+
+    std::string out(BINARY_EVENTS_MAGIC, sizeof(BINARY_EVENTS_MAGIC));
+    putU32(out, BINARY_EVENTS_VERSION);
+    putU32(out, static_cast<uint32_t>(table.size()));
+    putU32(out, static_cast<uint32_t>(data.events.size()));
+    putU32(out, channel);
+    table.write(out);
+    out += events;
+
+    std::ofstream f(path, std::ios::binary);
+    f.write(out.data(), out.size());
+    return static_cast<bool>(f);
+}
+
+names_and_events readBinaryEventsFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Error: File not found or cannot be opened - " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("Binary events file is truncated");
+    }
+    MappedFile file(mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0), st.st_size);
+    close(fd);
+    if (file.data == MAP_FAILED) {
+        throw std::runtime_error("Error: Cannot map - " + path);
+    }
+    madvise(file.data, file.size, MADV_SEQUENTIAL);
+
+    Reader reader(file.data, file.size);
+    if (reader.bytes(sizeof(BINARY_EVENTS_MAGIC)) != std::string_view(BINARY_EVENTS_MAGIC, sizeof(BINARY_EVENTS_MAGIC))) {
+        throw std::runtime_error("Not a binary events file - " + path);
+    }
+    uint32_t version = reader.u32();
+    if (version != 1 && version != BINARY_EVENTS_VERSION) {
+        throw std::runtime_error("Unsupported binary events file version - " + path);
+    }
+    uint32_t stringCount = reader.u32();
+    uint32_t eventCount = reader.u32();
+    uint32_t channel = reader.u32();
+
+    // Each string costs at least its 4 byte length, which bounds the reserve on hostile counts
+    std::vector<std::string_view> strings;
+    strings.reserve(std::min<size_t>(stringCount, file.size / 4));
+    for (uint32_t i = 0; i < stringCount; ++i) {
+        strings.push_back(reader.bytes(reader.u32()));
+    }
+    auto view = [&strings](uint32_t index) {
+        if (index >= strings.size()) throw std::runtime_error("Binary events file has a bad string index");
+        return strings[index];
+    };
+    auto string = [&view](uint32_t index) { return std::string(view(index)); };
+    auto detail = [&reader, &view, version]() {
+        if (version == 1) return DetailValue::parse(view(reader.u32()));
+        switch (reader.u8()) {
+            case DetailValue::Bool: return DetailValue::fromBool(reader.u8() != 0);
+            case DetailValue::Int: return DetailValue::fromInt(reader.i64());
+            case DetailValue::Double: {
+                int64_t bits = reader.i64();
+                double decimal;
+                std::memcpy(&decimal, &bits, sizeof(decimal));
+                return DetailValue::fromDouble(decimal);
+            }
+            case DetailValue::String: return DetailValue::fromString(view(reader.u32()));
+        }
+        throw std::runtime_error("Binary events file has a bad detail kind");
+    };
+
+    names_and_events result{string(channel), {}};
+    result.events.reserve(std::min<size_t>(eventCount, file.size / 24));
+    for (uint32_t i = 0; i < eventCount; ++i) {
+        std::string name = string(reader.u32());
+        std::string city = string(reader.u32());
+        int dateTime = static_cast<int>(reader.i64());
+        std::string description = string(reader.u32());
+        uint32_t infoCount = reader.u32();
+        std::map<std::string, DetailValue> generalInformation;
+        for (uint32_t j = 0; j < infoCount; ++j) {
+            std::string key = string(reader.u32());
+            generalInformation.emplace(std::move(key), detail());
+        }
+        result.events.emplace_back(result.channel_name, std::move(city), std::move(name), dateTime, std::move(description),
+                                   std::move(generalInformation));
+    }
+    return result;
+}
@@ -0,0 +1,135 @@
+#include "../include/BodyCompression.h"
+#include <algorithm>
+
+namespace {
+
+// Preset dictionary: the body keys and the values most reports repeat. deflate
+// finds matches closer to the end of the dictionary more cheaply, so the
+// strings every body contains come last.
+const char dictionary[] =
+    "police fire_dept ambulance emergency medical fire evacuated injured suspect vehicle "
+    "reported witnesses responding units backup paramedics requested situation under control "
+    "scene secured building traffic highway station central north south east west the of and "
+    "        severity:low\n        severity:medium\n        severity:high\n        severity:critical\n"
+    "        units_dispatched:\n        description:\n"
+    "        active:false\n        forces_arrival_at_scene:true\n"
+    "user:\ncity:\nevent name:\ndate time:1700000000\ngeneral information:\n"
+    "        active:true\n        forces_arrival_at_scene:false\ndescription:\n";
+
+const char base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+void appendBase64(const unsigned char* data, size_t size, std::string& out) {
+    size_t i = 0;
+    for (; i + 3 <= size; i += 3) {
+        unsigned bits = unsigned(data[i]) << 16 | unsigned(data[i + 1]) << 8 | data[i + 2];
+        out += base64Alphabet[bits >> 18];
+        out += base64Alphabet[(bits >> 12) & 63];
+        out += base64Alphabet[(bits >> 6) & 63];
+        out += base64Alphabet[bits & 63];
+    }
+    if (i < size) {
+        unsigned bits = unsigned(data[i]) << 16 | (i + 1 < size ? unsigned(data[i + 1]) << 8 : 0);
+        out += base64Alphabet[bits >> 18];
+        out += base64Alphabet[(bits >> 12) & 63];
+        out += i + 1 < size ? base64Alphabet[(bits >> 6) & 63] : '=';
+        out += '=';
+    }
+}
+
+int base64Value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+bool decodeBase64(std::string_view text, std::string& out) {
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r' || text.back() == ' ')) text.remove_suffix(1);
+    if (text.size() % 4 != 0) return false;
+    size_t padding = 0;
+    while (padding < 2 && padding < text.size() && text[text.size() - 1 - padding] == '=') ++padding;
+    out.clear();
+    out.reserve(text.size() / 4 * 3);
+    unsigned bits = 0;
+    for (size_t i = 0; i < text.size() - padding; ++i) {
+        int value = base64Value(text[i]);
+        if (value < 0) return false;
+        bits = bits << 6 | unsigned(value);
+        if (i % 4 == 3) {
+            out += static_cast<char>(bits >> 16);
+            out += static_cast<char>((bits >> 8) & 0xff);
+            out += static_cast<char>(bits & 0xff);
+        }
+    }
+    if (padding == 1) {
+        out += static_cast<char>(bits >> 10);
+        out += static_cast<char>((bits >> 2) & 0xff);
+    } else if (padding == 2) {
+        out += static_cast<char>(bits >> 4);
+    }
+    return true;
+}
+
+} // namespace
+
+BodyCompressor::BodyCompressor() : stream(), ready(false), buffer() {
+    // Raw deflate (negative window bits): no zlib header or checksum on every small body
+    ready = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+BodyCompressor::~BodyCompressor() {
+    if (ready) deflateEnd(&stream);
+}
+
+bool BodyCompressor::compress(std::string_view body, std::string& out) {
+    if (!ready || deflateReset(&stream) != Z_OK ||
+        deflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dictionary), sizeof(dictionary) - 1) != Z_OK) {
+        return false;
+    }
+    buffer.resize(deflateBound(&stream, body.size()));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+    stream.avail_in = static_cast<uInt>(body.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&buffer[0]);
+    stream.avail_out = static_cast<uInt>(buffer.size());
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) return false;
+
+    size_t compressedSize = buffer.size() - stream.avail_out;
+    if ((compressedSize + 2) / 3 * 4 >= body.size()) return false;
+    appendBase64(reinterpret_cast<const unsigned char*>(buffer.data()), compressedSize, out);
+    return true;
+}
+
+BodyDecompressor::BodyDecompressor() : stream(), ready(false), buffer() {
+    ready = inflateInit2(&stream, -15) == Z_OK;
+}
+
+BodyDecompressor::~BodyDecompressor() {
+    if (ready) inflateEnd(&stream);
+}
+
+bool BodyDecompressor::decompress(std::string_view encoded, std::string& out) {
+    if (!ready || !decodeBase64(encoded, buffer) || inflateReset(&stream) != Z_OK ||
+        inflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dictionary), sizeof(dictionary) - 1) != Z_OK) {
+        return false;
+    }
+    stream.next_in = reinterpret_cast<Bytef*>(&buffer[0]);
+    stream.avail_in = static_cast<uInt>(buffer.size());
+
+    out.resize(std::min(MAX_BODY_SIZE, buffer.size() * 4 + 256));
+    size_t produced = 0;
+    while (true) {
+        stream.next_out = reinterpret_cast<Bytef*>(&out[produced]);
+        stream.avail_out = static_cast<uInt>(out.size() - produced);
+        int result = inflate(&stream, Z_NO_FLUSH);
+        produced = out.size() - stream.avail_out;
+        if (result == Z_STREAM_END) break;
+        if (result != Z_OK && result != Z_BUF_ERROR) return false;
+        if (stream.avail_out != 0) return false; // input ran out before the end of the stream
+        if (out.size() == MAX_BODY_SIZE) return false;
+        out.resize(std::min(MAX_BODY_SIZE, out.size() * 2));
+    }
+    out.resize(produced);
+    return true;
+}
@@ -1,4 +1,10 @@
 #include "../include/ConnectionHandler.h"
+#include "../include/Metrics.h"
+#include "../include/UringSocket.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <netinet/tcp.h>
 
 using boost::asio::ip::tcp;
 
@@ -8,54 +14,159 @@ using std::cerr;
 using std::endl;
 using std::string;
 
-ConnectionHandler::ConnectionHandler(string host, short port) : host_(host), port_(port), io_service_(),
-                                                                socket_(io_service_) {}
+// Options asio has no name for, declared the way asio declares its own
+typedef boost::asio::detail::socket_option::boolean<IPPROTO_TCP, TCP_QUICKACK> tcp_quick_ack;
+#ifdef SO_BUSY_POLL
+typedef boost::asio::detail::socket_option::integer<SOL_SOCKET, SO_BUSY_POLL> socket_busy_poll;
+#endif
+
+ConnectionHandler::ConnectionHandler(string host, short port, const SocketOptions& options)
+    : host_(host), port_(port), options_(options), local_(isUnixHost(host)), io_service_(), socket_(io_service_),
+      lastReceive_(0), lastSend_(0), uring_(), readBuffer_(READ_BUFFER_SIZE), readStart_(0), readEnd_(0) {}
+
+constexpr size_t ConnectionHandler::READ_BUFFER_SIZE;
 
 ConnectionHandler::~ConnectionHandler() {
 	close();
 }
 
-bool ConnectionHandler::connect() {
-	std::cout << "Starting connect to "
-	          << host_ << ":" << port_ << std::endl;
+bool ConnectionHandler::isUnixHost(const std::string& host) {
+	return host.compare(0, sizeof(UNIX_HOST_PREFIX) - 1, UNIX_HOST_PREFIX) == 0;
+}
+
+bool ConnectionHandler::connect(bool announce) {
+	if (announce) {
+		std::cout << "Starting connect to " << host_;
+		if (!local_) std::cout << ":" << port_;
+		std::cout << std::endl;
+	}
 	try {
-		tcp::endpoint endpoint(boost::asio::ip::address::from_string(host_), port_); // the server endpoint
+		// the server endpoint
+		boost::asio::generic::stream_protocol::endpoint endpoint = local_
+			? boost::asio::generic::stream_protocol::endpoint(
+				boost::asio::local::stream_protocol::endpoint(host_.substr(sizeof(UNIX_HOST_PREFIX) - 1)))
+			: boost::asio::generic::stream_protocol::endpoint(
+				tcp::endpoint(boost::asio::ip::address::from_string(host_), port_));
 		boost::system::error_code error;
-		socket_.connect(endpoint, error);
+		socket_.open(endpoint.protocol(), error);
+		if (!error) {
+			applyOptions(); // before connecting, so the buffer sizes shape the TCP window
+			socket_.connect(endpoint, error);
+		}
 		if (error){
 			throw boost::system::system_error(error);
 		}
+		lastReceive_ = lastSend_ = Metrics::now();
 	}
 	catch (std::exception &e) {
 		std::cerr << "Connection failed (Error: " << e.what() << ')' << std::endl;
 		return false;
 	}
+	if (options_.ioUring) {
+		std::string error;
+		uring_ = UringSocket::open(socket_.native_handle(), options_.quickAck && !local_, error);
+		// Said once per process, not for every standby and reconnect
+		static std::atomic<bool> reported(false);
+		if (!uring_ && !reported.exchange(true))
+			std::cerr << "io_uring unavailable (" << error << "), using asio" << std::endl;
+	}
 	return true;
 }
 
-bool ConnectionHandler::getBytes(char bytes[], unsigned int bytesToRead) {
-	size_t tmp = 0;
+template <typename Option>
+void ConnectionHandler::setOption(const Option& option, const char* name) {
 	boost::system::error_code error;
-	try {
-		while (!error && bytesToRead > tmp) {
-			tmp += socket_.read_some(boost::asio::buffer(bytes + tmp, bytesToRead - tmp), error);
+	socket_.set_option(option, error);
+	if (error)
+		std::cerr << "Cannot set " << name << " (Error: " << error.message() << ')' << std::endl;
+}
+
+void ConnectionHandler::applyOptions() {
+	if (options_.sendBuffer > 0)
+		setOption(boost::asio::socket_base::send_buffer_size(options_.sendBuffer), "SO_SNDBUF");
+	if (options_.receiveBuffer > 0)
+		setOption(boost::asio::socket_base::receive_buffer_size(options_.receiveBuffer), "SO_RCVBUF");
+	if (local_)
+		return;
+	if (options_.noDelay)
+		setOption(tcp::no_delay(true), "TCP_NODELAY");
+	if (options_.quickAck)
+		setOption(tcp_quick_ack(true), "TCP_QUICKACK");
+	if (options_.busyPollMicros > 0) {
+#ifdef SO_BUSY_POLL
+		setOption(socket_busy_poll(options_.busyPollMicros), "SO_BUSY_POLL");
+#else
+		std::cerr << "Cannot set SO_BUSY_POLL (Error: not supported on this platform)" << std::endl;
+#endif
+	}
+}
+
+bool ConnectionHandler::fill() {
+	// Callers hand out every received byte first, a long frame's head included, so the whole buffer is free
+	readStart_ = readEnd_ = 0;
+	char* free = readBuffer_.data();
+	size_t room = readBuffer_.size();
+
+	size_t received = 0;
+	if (uring_) {
+		int error = 0;
+		received = uring_->receive(free, room, error);
+		if (received == 0) {
+			std::cerr << "recv failed (Error: " << (error == 0 ? "End of file" : std::strerror(error)) << ')' << std::endl;
+			return false;
+		}
+	} else {
+		boost::system::error_code error;
+		received = socket_.read_some(boost::asio::buffer(free, room), error);
+		Metrics::increment(Metrics::SocketReads);
+		if (options_.quickAck && !local_) {
+			boost::system::error_code ignored;
+			socket_.set_option(tcp_quick_ack(true), ignored);
+		}
+		if (error) {
+			std::cerr << "recv failed (Error: " << error.message() << ')' << std::endl;
+			return false;
 		}
-		if (error)
-			throw boost::system::system_error(error);
-	} catch (std::exception &e) {
-		std::cerr << "recv failed (Error: " << e.what() << ')' << std::endl;
-		return false;
+	}
+	readEnd_ += received;
+	lastReceive_.store(Metrics::now(), std::memory_order_relaxed);
+	Metrics::increment(Metrics::BytesReceived, received);
+	return true;
+}
+
+bool ConnectionHandler::getBytes(char bytes[], unsigned int bytesToRead) {
+	size_t done = 0;
+	while (done < bytesToRead) {
+		if (readStart_ == readEnd_ && !fill())
+			return false;
+		size_t count = std::min<size_t>(bytesToRead - done, readEnd_ - readStart_);
+		std::memcpy(bytes + done, readBuffer_.data() + readStart_, count);
+		readStart_ += count;
+		done += count;
 	}
 	return true;
 }
 
 bool ConnectionHandler::sendBytes(const char bytes[], int bytesToWrite) {
+	if (uring_) {
+		int error = 0;
+		if (!uring_->send(bytes, bytesToWrite, error)) {
+			std::cerr << "send failed (Error: " << std::strerror(error) << ')' << std::endl;
+			return false;
+		}
+		lastSend_.store(Metrics::now(), std::memory_order_relaxed);
+		Metrics::increment(Metrics::BytesSent, bytesToWrite);
+		return true;
+	}
 	int tmp = 0;
 	boost::system::error_code error;
 	try {
 		while (!error && bytesToWrite > tmp) {
 			tmp += socket_.write_some(boost::asio::buffer(bytes + tmp, bytesToWrite - tmp), error);
+			Metrics::increment(Metrics::SocketWrites);
+			if (!error) lastSend_.store(Metrics::now(), std::memory_order_relaxed);
 		}
+		Metrics::increment(Metrics::BytesSent, tmp);
 		if (error)
 			throw boost::system::system_error(error);
 	} catch (std::exception &e) {
@@ -75,35 +186,82 @@ bool ConnectionHandler::sendLine(std::string &line) {
 
 
 bool ConnectionHandler::getFrameAscii(std::string &frame, char delimiter) {
-	char ch;
-	// Stop when we encounter the null character.
+	TraceSpan span("socket read");
+	bool started = false;
+	// Stop when we encounter the delimiter.
 	// Notice that the null character is not appended to the frame string.
-	try {
-		do {
-			if (!getBytes(&ch, 1)) {
-				return false;
-			}
-			if (ch != '\0')
-				frame.append(1, ch);
-		} while (delimiter != ch);
-	} catch (std::exception &e) {
-		std::cerr << "recv failed2 (Error: " << e.what() << ')' << std::endl;
-		return false;
+	while (true) {
+		if (readStart_ == readEnd_ && !fill())
+			return false;
+		const char* next = readBuffer_.data() + readStart_;
+		const char* end = readBuffer_.data() + readEnd_;
+		if (!started) {
+			while (next != end && *next != delimiter && (*next == '\n' || *next == '\r'))
+				++next; // heart-beat
+			readStart_ = next - readBuffer_.data();
+			if (next == end)
+				continue;
+			started = true;
+		}
+		const char* found = static_cast<const char*>(std::memchr(next, delimiter, end - next));
+		if (found == nullptr) {
+			frame.append(next, end);
+			readStart_ = readEnd_;
+			continue;
+		}
+		frame.append(next, found);
+		if (delimiter != '\0')
+			frame.push_back(delimiter);
+		readStart_ = found + 1 - readBuffer_.data();
+		break;
 	}
+	Metrics::increment(Metrics::FramesReceived);
 	return true;
 }
 
+bool ConnectionHandler::hasBufferedFrame(char delimiter) const {
+	return std::memchr(readBuffer_.data() + readStart_, delimiter, readEnd_ - readStart_) != nullptr;
+}
+
 bool ConnectionHandler::sendFrameAscii(const std::string &frame, char delimiter) {
-	bool result = sendBytes(frame.c_str(), frame.length());
-	if (!result) return false;
-	return sendBytes(&delimiter, 1);
+	if (uring_) {
+		int error = 0;
+		if (!uring_->send(frame.data(), frame.size(), &delimiter, 1, error)) {
+			std::cerr << "send failed (Error: " << std::strerror(error) << ')' << std::endl;
+			return false;
+		}
+		lastSend_.store(Metrics::now(), std::memory_order_relaxed);
+		Metrics::increment(Metrics::BytesSent, frame.size() + 1);
+		Metrics::increment(Metrics::FramesSent);
+		return true;
+	}
+	// Frame and delimiter go out in one gathered write: written separately, the lone delimiter
+	// waits for the ACK of the frame under Nagle, which the server may delay by ~40 ms
+	std::array<boost::asio::const_buffer, 2> buffers = {boost::asio::buffer(frame), boost::asio::buffer(&delimiter, 1)};
+	boost::system::error_code error;
+	size_t written = boost::asio::write(socket_, buffers, error);
+	Metrics::increment(Metrics::SocketWrites);
+	Metrics::increment(Metrics::BytesSent, written);
+	if (written > 0) lastSend_.store(Metrics::now(), std::memory_order_relaxed);
+	if (error) {
+		std::cerr << "send failed (Error: " << error.message() << ')' << std::endl;
+		return false;
+	}
+	Metrics::increment(Metrics::FramesSent);
+	return true;
 }
 
 // Close down the connection properly.
 void ConnectionHandler::close() {
+	uring_.reset();
 	try {
 		socket_.close();
 	} catch (...) {
 		std::cout << "closing failed: connection already closed" << std::endl;
 	}
 }
+
+void ConnectionHandler::shutdown() {
+	boost::system::error_code error;
+	socket_.shutdown(boost::asio::socket_base::shutdown_both, error);
+}
@@ -0,0 +1,109 @@
+#include "../include/DateFormatter.h"
+#include <climits>
+
+const char DateFormatter::digitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+namespace {
+
+// Offsets are cached per window of 2^21 seconds (~24 days). A window whose
+// two ends share the same offset cannot contain a DST switch, since zones
+// switch at most twice a year; windows that do contain one fall back to an
+// exact localtime_r lookup.
+constexpr int WINDOW_SHIFT = 21;
+constexpr int CACHE_SLOTS = 8;
+
+struct OffsetCacheEntry {
+    long window = LONG_MIN;
+    long offset = 0;
+    bool mixed = false;
+};
+
+thread_local OffsetCacheEntry offsetCache[CACHE_SLOTS];
+
+long localOffset(long epochTime) {
+    std::time_t time = epochTime;
+    std::tm tm{};
+    if (localtime_r(&time, &tm) == nullptr) return 0;
+    return tm.tm_gmtoff;
+}
+
+long floorDiv(long a, long b) {
+    long q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+} // namespace
+
+long DateFormatter::utcOffset(long epochTime) {
+    long window = epochTime >> WINDOW_SHIFT;
+    OffsetCacheEntry& entry = offsetCache[window & (CACHE_SLOTS - 1)];
+    if (entry.window != window) {
+        long start = window << WINDOW_SHIFT;
+        long end = start + (1L << WINDOW_SHIFT) - 1;
+        entry.window = window;
+        entry.offset = localOffset(start);
+        entry.mixed = localOffset(end) != entry.offset;
+    }
+    return entry.mixed ? localOffset(epochTime) : entry.offset;
+}
+
+void DateFormatter::format(long epochTime, char* out) const {
+    long local = epochTime + utcOffset(epochTime);
+    long days = floorDiv(local, 86400);
+    long secs = local - days * 86400;
+
+    // Civil date from days since 1970-01-01 (proleptic Gregorian calendar)
+    long z = days + 719468;
+    long era = floorDiv(z, 146097);
+    long doe = z - era * 146097;
+    long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long mp = (5 * doy + 2) / 153;
+    long day = doy - (153 * mp + 2) / 5 + 1;
+    long month = mp < 10 ? mp + 3 : mp - 9;
+    long year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+
+    long hour = secs / 3600;
+    long minute = (secs / 60) % 60;
+    long second = secs % 60;
+
+    // Years outside 0000-9999 cannot be represented in four digits; clamp them.
+    if (year < 0) year = 0;
+    if (year > 9999) year = 9999;
+
+    out[0] = digitPairs[day * 2];
+    out[1] = digitPairs[day * 2 + 1];
+    out[2] = '/';
+    out[3] = digitPairs[month * 2];
+    out[4] = digitPairs[month * 2 + 1];
+    out[5] = '/';
+    out[6] = digitPairs[(year / 100) * 2];
+    out[7] = digitPairs[(year / 100) * 2 + 1];
+    out[8] = digitPairs[(year % 100) * 2];
+    out[9] = digitPairs[(year % 100) * 2 + 1];
+    out[10] = ' ';
+    out[11] = digitPairs[hour * 2];
+    out[12] = digitPairs[hour * 2 + 1];
+    out[13] = ':';
+    out[14] = digitPairs[minute * 2];
+    out[15] = digitPairs[minute * 2 + 1];
+    out[16] = ':';
+    out[17] = digitPairs[second * 2];
+    out[18] = digitPairs[second * 2 + 1];
+}
+
+std::string DateFormatter::format(long epochTime) const {
+    std::string result(LENGTH, '\0');
+    format(epochTime, &result[0]);
+    return result;
+}
@@ -0,0 +1,192 @@
+#include "../include/DetailValue.h"
+#include <atomic>
+#include <charconv>
+#include <mutex>
+#include <unordered_map>
+
+struct DetailValue::SharedString {
+    std::atomic<uint32_t> refs;
+    bool interned;
+    std::string text;
+    SharedString(std::string_view text, bool interned) : refs(1), interned(interned), text(text) {}
+};
+
+// The interned strings some value still refers to, keyed by a view of their own text
+struct DetailValue::InternTable {
+    std::mutex mutex;
+    std::unordered_map<std::string_view, SharedString*> strings;
+    InternTable() : mutex(), strings() {}
+};
+
+DetailValue::InternTable& DetailValue::internTable() {
+    static InternTable table;
+    return table;
+}
+
+constexpr size_t DetailValue::MAX_INTERNED_LENGTH;
+
+DetailValue::SharedString* DetailValue::share(std::string_view text) {
+    if (text.empty()) return nullptr;
+    if (text.size() > MAX_INTERNED_LENGTH) return new SharedString(text, false);
+
+    InternTable& table = internTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto it = table.strings.find(text);
+    if (it != table.strings.end()) {
+        SharedString* shared = it->second;
+        // A count that already reached zero belongs to a string being released; it is never revived
+        uint32_t refs = shared->refs.load(std::memory_order_relaxed);
+        while (refs != 0) {
+            if (shared->refs.compare_exchange_weak(refs, refs + 1, std::memory_order_relaxed)) return shared;
+        }
+        table.strings.erase(it);
+    }
+    SharedString* shared = new SharedString(text, true);
+    table.strings.emplace(shared->text, shared);
+    return shared;
+}
+
+void DetailValue::release(SharedString* text) {
+    if (text == nullptr || text->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    if (text->interned) {
+        InternTable& table = internTable();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        // share may already have put a fresh copy in its place
+        auto it = table.strings.find(text->text);
+        if (it != table.strings.end() && it->second == text) table.strings.erase(it);
+    }
+    delete text;
+}
+
+DetailValue::DetailValue() : type(String), value() {
+    value.text = nullptr;
+}
+
+DetailValue::DetailValue(const DetailValue& other) : type(other.type), value(other.value) {
+    if (type == String && value.text != nullptr) value.text->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+DetailValue::DetailValue(DetailValue&& other) noexcept : type(other.type), value(other.value) {
+    other.type = String;
+    other.value.text = nullptr;
+}
+
+DetailValue& DetailValue::operator=(const DetailValue& other) {
+    DetailValue copy(other);
+    return *this = std::move(copy);
+}
+
+DetailValue& DetailValue::operator=(DetailValue&& other) noexcept {
+    if (this != &other) {
+        if (type == String) release(value.text);
+        type = other.type;
+        value = other.value;
+        other.type = String;
+        other.value.text = nullptr;
+    }
+    return *this;
+}
+
+DetailValue::~DetailValue() {
+    if (type == String) release(value.text);
+}
+
+DetailValue DetailValue::fromBool(bool flag) {
+    DetailValue result;
+    result.type = Bool;
+    result.value.flag = flag;
+    return result;
+}
+
+DetailValue DetailValue::fromInt(int64_t integer) {
+    DetailValue result;
+    result.type = Int;
+    result.value.integer = integer;
+    return result;
+}
+
+DetailValue DetailValue::fromDouble(double decimal) {
+    DetailValue result;
+    result.type = Double;
+    result.value.decimal = decimal;
+    return result;
+}
+
+DetailValue DetailValue::fromString(std::string_view text) {
+    DetailValue result;
+    result.value.text = share(text);
+    return result;
+}
+
+const std::string& DetailValue::asString() const {
+    static const std::string empty;
+    return value.text != nullptr ? value.text->text : empty;
+}
+
+DetailValue DetailValue::parse(std::string_view text) {
+    if (text == "true") return fromBool(true);
+    if (text == "false") return fromBool(false);
+
+    // Numbers as JSON writes them; anything spelled differently from appendTo's output stays a string
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    bool numeric = !text.empty() && text.find_first_not_of("0123456789-+.eE") == std::string_view::npos &&
+                   (text[0] == '-' || (text[0] >= '0' && text[0] <= '9'));
+    if (numeric) {
+        int64_t integer = 0;
+        auto [intEnd, intError] = std::from_chars(begin, end, integer);
+        if (intError == std::errc() && intEnd == end) {
+            DetailValue result = fromInt(integer);
+            if (result.toString() == text) return result;
+        } else {
+            double decimal = 0;
+            auto [doubleEnd, doubleError] = std::from_chars(begin, end, decimal);
+            if (doubleError == std::errc() && doubleEnd == end) {
+                DetailValue result = fromDouble(decimal);
+                if (result.toString() == text) return result;
+            }
+        }
+    }
+    return fromString(text);
+}
+
+void DetailValue::appendTo(std::string& out) const {
+    char buffer[32];
+    switch (type) {
+        case Bool:
+            out.append(value.flag ? "true" : "false");
+            return;
+        case Int:
+            out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value.integer).ptr);
+            return;
+        case Double: {
+            char* last = std::to_chars(buffer, buffer + sizeof(buffer), value.decimal).ptr;
+            std::string_view written(buffer, last - buffer);
+            out.append(written);
+            // A whole number keeps a fractional digit, as nlohmann's dump() writes it, so it reads back as a decimal
+            if (written.find_first_of(".eEn") == std::string_view::npos) out.append(".0");
+            return;
+        }
+        case String:
+            out.append(asString());
+            return;
+    }
+}
+
+std::string DetailValue::toString() const {
+    std::string out;
+    appendTo(out);
+    return out;
+}
+
+bool DetailValue::operator==(const DetailValue& other) const {
+    if (type != other.type) return false;
+    switch (type) {
+        case Bool: return value.flag == other.value.flag;
+        case Int: return value.integer == other.value.integer;
+        case Double: return value.decimal == other.value.decimal;
+        // Interned strings are equal only when shared; longer ones may be equal copies
+        case String: return value.text == other.value.text || asString() == other.asString();
+    }
+    return false;
+}
@@ -0,0 +1,170 @@
+#include "../include/EventGenerator.h"
+#include <cctype>
+#include <cmath>
+#include <fstream>
+
+namespace {
+
+const std::vector<std::string> channels = {"police", "fire_dept", "ambulance", "emergency"};
+const std::vector<double> channelWeights = {0.4, 0.25, 0.25, 0.1};
+
+const std::vector<std::string> cities = {
+    "Liberty City", "Springfield", "Gotham", "Metropolis", "Beer Sheva", "Tel Aviv", "Haifa",
+    "Jerusalem", "Eilat", "Ashdod", "Netanya", "Rishon LeZion", "Holon", "Ramat Gan",
+    "Herzliya", "Raanana", "Kfar Saba", "Modiin", "Dimona", "Arad", "Ofakim", "Sderot"};
+
+const std::map<std::string, std::vector<std::string>> eventNames = {
+    {"police", {"Grand Theft Auto", "Burglary", "Armed Robbery", "Traffic Stop", "Vandalism", "Missing Person"}},
+    {"fire_dept", {"House Fire", "Forest Fire", "Gas Leak", "Car Fire", "Chemical Spill"}},
+    {"ambulance", {"Heart Attack", "Car Accident", "Fall Injury", "Allergic Reaction", "Mass Casualty Incident"}},
+    {"emergency", {"Earthquake", "Flood", "Power Outage", "Building Collapse"}}};
+
+const std::vector<std::string> words = {
+    "suspect", "vehicle", "reported", "near", "the", "central", "station", "units", "responding",
+    "witnesses", "described", "smoke", "visible", "from", "highway", "residents", "evacuated",
+    "injured", "two", "several", "civilians", "scene", "secured", "awaiting", "backup", "heavy",
+    "traffic", "blocked", "north", "entrance", "caller", "says", "alarm", "building", "floor",
+    "paramedics", "requested", "additional", "support", "situation", "under", "control", "a", "of"};
+
+const std::vector<std::string> severities = {"low", "medium", "high", "critical"};
+
+// Zipf-like: a handful of cities produce most of the traffic
+std::vector<double> cityWeights() {
+    std::vector<double> weights(cities.size());
+    for (size_t i = 0; i < weights.size(); ++i) {
+        weights[i] = 1.0 / (i + 1);
+    }
+    return weights;
+}
+
+} // namespace
+
+EventGenerator::EventGenerator(const EventGeneratorOptions& options)
+    : options(options), rng(options.seed),
+      channelDistribution(channelWeights.begin(), channelWeights.end()),
+      cityDistribution() {
+    std::vector<double> weights = cityWeights();
+    cityDistribution = std::discrete_distribution<size_t>(weights.begin(), weights.end());
+}
+
+std::string EventGenerator::pickChannel() {
+    return channels[channelDistribution(rng)];
+}
+
+std::string EventGenerator::pickCity() {
+    return cities[cityDistribution(rng)];
+}
+
+std::string EventGenerator::pickEventName(const std::string& channel) {
+    auto it = eventNames.find(channel);
+    const std::vector<std::string>& names = it != eventNames.end() ? it->second : eventNames.at("emergency");
+    std::uniform_int_distribution<size_t> distribution(0, names.size() - 1);
+    return names[distribution(rng)];
+}
+
+std::string EventGenerator::makeDescription() {
+    // Log-normal lengths: mostly short notes with the occasional long narrative
+    const double sigma = 0.6;
+    double mu = std::log(static_cast<double>(std::max<size_t>(options.meanDescriptionLength, 1))) - sigma * sigma / 2;
+    std::lognormal_distribution<double> lengthDistribution(mu, sigma);
+    size_t length = static_cast<size_t>(lengthDistribution(rng)) + 1;
+
+    std::uniform_int_distribution<size_t> wordDistribution(0, words.size() - 1);
+    std::string description;
+    description.reserve(length + 16);
+    while (description.size() < length) {
+        if (!description.empty()) description += ' ';
+        description += words[wordDistribution(rng)];
+    }
+    description[0] = static_cast<char>(std::toupper(description[0]));
+    description += '.';
+    return description;
+}
+
+std::map<std::string, DetailValue> EventGenerator::makeGeneralInformation() {
+    std::bernoulli_distribution active(0.6);
+    std::bernoulli_distribution forcesArrived(0.4);
+    std::bernoulli_distribution extra(0.3);
+    std::map<std::string, DetailValue> info;
+    info["active"] = DetailValue::fromBool(active(rng));
+    info["forces_arrival_at_scene"] = DetailValue::fromBool(forcesArrived(rng));
+    if (extra(rng)) {
+        std::poisson_distribution<int> units(3);
+        info["units_dispatched"] = DetailValue::fromInt(units(rng) + 1);
+    }
+    if (extra(rng)) {
+        std::uniform_int_distribution<size_t> severity(0, severities.size() - 1);
+        info["severity"] = DetailValue::fromString(severities[severity(rng)]);
+    }
+    return info;
+}
+
+names_and_events EventGenerator::generate() {
+    std::string channel = options.channel.empty() ? pickChannel() : options.channel;
+    std::uniform_int_distribution<long> timeDistribution(0, std::max(options.timeSpan, 1L) - 1);
+
+    names_and_events data{channel, {}};
+    data.events.reserve(options.eventCount);
+    for (size_t i = 0; i < options.eventCount; ++i) {
+        std::string name = pickEventName(channel);
+        std::string city = pickCity();
+        int dateTime = static_cast<int>(options.startTime + timeDistribution(rng));
+        std::string description = makeDescription();
+        data.events.emplace_back(channel, std::move(city), std::move(name), dateTime, std::move(description),
+                                 makeGeneralInformation());
+    }
+    return data;
+}
+
+namespace {
+
+void writeJsonString(std::ofstream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            default: out << c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+bool EventGenerator::writeJson(const names_and_events& data, const std::string& path) {
+    std::ofstream out(path);
+    if (!out) return false;
+
+    out << "{\n    \"channel_name\": ";
+    writeJsonString(out, data.channel_name);
+    out << ",\n    \"events\": [";
+    for (size_t i = 0; i < data.events.size(); ++i) {
+        const Event& event = data.events[i];
+        out << (i == 0 ? "\n" : ",\n") << "        {\n            \"event_name\": ";
+        writeJsonString(out, event.get_name());
+        out << ",\n            \"city\": ";
+        writeJsonString(out, event.get_city());
+        out << ",\n            \"date_time\": " << event.get_date_time() << ",\n            \"description\": ";
+        writeJsonString(out, event.get_description());
+        out << ",\n            \"general_information\": {";
+        bool first = true;
+        for (const auto& [key, value] : event.get_general_information()) {
+            out << (first ? "\n" : ",\n") << "                ";
+            writeJsonString(out, key);
+            out << ": ";
+            // Booleans and numbers go out unquoted so they read back with the same kind
+            if (value.kind() == DetailValue::String) {
+                writeJsonString(out, value.asString());
+            } else {
+                out << value.toString();
+            }
+            first = false;
+        }
+        out << "\n            }\n        }";
+    }
+    out << "\n    ]\n}\n";
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,17 @@
+#include "../include/EventSource.h"
+
+EventSource::~EventSource() {}
+
+std::unique_ptr<EventSource> EventSource::create() {
+#ifdef EMI_FAST_JSON
+    return std::unique_ptr<EventSource>(new FastJsonEventSource());
+#else
+    return std::unique_ptr<EventSource>(new NlohmannEventSource());
+#endif
+}
+
+std::unique_ptr<EventSource> EventSource::create(const std::string& name) {
+    if (name == "nlohmann") return std::unique_ptr<EventSource>(new NlohmannEventSource());
+    if (name == "fast") return std::unique_ptr<EventSource>(new FastJsonEventSource());
+    return nullptr;
+}
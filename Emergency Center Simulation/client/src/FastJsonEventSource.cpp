@@ -0,0 +1,114 @@
+#include "../include/EventSource.h"
+#include "../include/FastJson.h"
+#include <charconv>
+#include <fstream>
+
+namespace {
+
+std::string readFile(const std::string& path) {
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if (!f) {
+        throw std::runtime_error("Error: File not found or cannot be opened - " + path);
+    }
+    std::string content(static_cast<size_t>(f.tellg()), '\0');
+    f.seekg(0);
+    f.read(&content[0], content.size());
+    return content;
+}
+
+// A general_information value with its JSON kind; integers that do not fit an
+// int64 become decimals and objects, arrays and null are kept as their text,
+// as NlohmannEventSource does
+DetailValue readDetail(FastJson& json) {
+    char c = json.peek();
+    if (c == '"') return DetailValue::fromString(json.string());
+    if (c == 't' || c == 'f') return DetailValue::fromBool(json.literal() == "true");
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        std::string_view token = json.number();
+        const char* tokenEnd = token.data() + token.size();
+        int64_t integer = 0;
+        auto result = std::from_chars(token.data(), tokenEnd, integer);
+        if (result.ec == std::errc() && result.ptr == tokenEnd) return DetailValue::fromInt(integer);
+        double decimal = 0;
+        auto real = std::from_chars(token.data(), tokenEnd, decimal);
+        if (real.ec == std::errc() && real.ptr == tokenEnd) return DetailValue::fromDouble(decimal);
+        return DetailValue::fromString(token);
+    }
+    return DetailValue::fromString(json.dump());
+}
+
+// Fields of one event as they come out of the object, in whatever order
+struct EventFields {
+    std::string name;
+    std::string city;
+    int dateTime;
+    std::string description;
+    std::map<std::string, DetailValue> generalInformation;
+    unsigned seen;
+};
+
+enum : unsigned { NameSeen = 1, CitySeen = 2, DateTimeSeen = 4, DescriptionSeen = 8, AllSeen = 15 };
+
+void readEvent(FastJson& json, const std::string& channel, std::vector<Event>& events) {
+    EventFields fields{"", "", 0, "", {}, 0};
+    json.object([&](std::string_view key) {
+        if (key == "event_name") {
+            fields.name = json.string();
+            fields.seen |= NameSeen;
+        } else if (key == "city") {
+            fields.city = json.string();
+            fields.seen |= CitySeen;
+        } else if (key == "date_time") {
+            fields.dateTime = static_cast<int>(json.integer());
+            fields.seen |= DateTimeSeen;
+        } else if (key == "description") {
+            fields.description = json.string();
+            fields.seen |= DescriptionSeen;
+        } else if (key == "general_information") {
+            json.object([&](std::string_view infoKey) {
+                fields.generalInformation.insert_or_assign(std::string(infoKey), readDetail(json));
+            });
+        } else {
+            json.skipValue();
+        }
+    });
+    if (fields.seen != AllSeen) {
+        throw std::runtime_error("Error processing events: event " + std::to_string(events.size()) +
+                                 " is missing a required field");
+    }
+    events.emplace_back(channel, std::move(fields.city), std::move(fields.name), fields.dateTime,
+                        std::move(fields.description), std::move(fields.generalInformation));
+}
+
+} // namespace
+
+names_and_events FastJsonEventSource::load(const std::string& path)
+{
+    std::string content = readFile(path);
+    FastJson json(content.data(), content.size());
+
+    names_and_events result{"", {}};
+    bool hasChannel = false;
+    json.object([&](std::string_view key) {
+        if (key == "channel_name") {
+            result.channel_name = json.string();
+            hasChannel = true;
+        } else if (key == "events") {
+            json.array([&]() { readEvent(json, result.channel_name, result.events); });
+        } else {
+            json.skipValue();
+        }
+    });
+    if (!json.atEnd()) {
+        throw std::runtime_error("JSON parse error: trailing characters after the document");
+    }
+    if (!hasChannel) {
+        throw std::runtime_error("Error processing events: missing channel_name");
+    }
+
+    // channel_name may come after the events in the file
+    for (Event& event : result.events) {
+        if (event.get_channel_name() != result.channel_name) event.setEventChannelName(result.channel_name);
+    }
+    return result;
+}
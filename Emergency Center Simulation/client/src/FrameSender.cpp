@@ -0,0 +1,164 @@
+#include "../include/FrameSender.h"
+#include "../include/Metrics.h"
+#include <iostream>
+#include <vector>
+
+FrameSender::FrameSender(size_t capacity)
+    : mutex(), changed(), queue(), queuedBytes(0), capacity(capacity), connection(nullptr), down(false),
+      writing(false), stopping(false), fullReported(false), thread() {}
+
+FrameSender::~FrameSender() {
+    stop();
+}
+
+void FrameSender::start(ConnectionHandler* newConnection) {
+    stop();
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.clear();
+    queuedBytes = 0;
+    connection = newConnection;
+    down = false;
+    stopping = false;
+    thread = std::thread(&FrameSender::run, this);
+}
+
+void FrameSender::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    if (thread.joinable()) thread.join();
+}
+
+bool FrameSender::send(std::string&& frame, bool holdWhileDown, std::string&& note) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!thread.joinable() || stopping) return false;
+    if (down && !holdWhileDown) return true;
+    size_t size = frame.size() + 1;
+    // An empty queue always takes the frame, so one larger than capacity cannot wait forever
+    if (queuedBytes > 0 && queuedBytes + size > capacity) {
+        if (!fullReported) std::cout << "Send queue is full, waiting for the server to catch up...\n";
+        fullReported = true;
+        uint64_t start = Metrics::now();
+        changed.wait(lock, [&] { return stopping || down || queuedBytes == 0 || queuedBytes + size <= capacity; });
+        Metrics::record(Metrics::SendQueueWait, Metrics::now() - start);
+        if (stopping) return false;
+        // Nothing drains the queue until the reconnect, which may need locks the caller holds
+        if (queuedBytes > 0 && queuedBytes + size > capacity) return false;
+    }
+    if (down) Metrics::increment(Metrics::FramesHeld);
+    queuedBytes += size;
+    queue.push_back(Item{std::move(frame), holdWhileDown, std::move(note), false});
+    lock.unlock();
+    changed.notify_all();
+    return true;
+}
+
+bool FrameSender::waitForConnection() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return stopping || !down; });
+    return !stopping && thread.joinable();
+}
+
+bool FrameSender::sendHeartBeat() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!thread.joinable() || stopping || down || writing || !queue.empty()) return false;
+        queuedBytes += 1;
+        queue.push_back(Item{std::string(), false, std::string(), true});
+    }
+    changed.notify_all();
+    return true;
+}
+
+void FrameSender::dropUnheld() {
+    for (auto it = queue.begin(); it != queue.end();) {
+        if (it->holdWhileDown) {
+            ++it;
+        } else {
+            queuedBytes -= it->frame.size() + 1;
+            it = queue.erase(it);
+        }
+    }
+}
+
+void FrameSender::connectionLost() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!down && connection != nullptr) connection->shutdown();
+        down = true;
+        dropUnheld();
+    }
+    changed.notify_all(); // a send waiting for room gives up
+}
+
+void FrameSender::setConnection(ConnectionHandler* newConnection) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return !writing; });
+        connection = newConnection;
+        down = false;
+    }
+    changed.notify_all();
+}
+
+bool FrameSender::isDown() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return down;
+}
+
+void FrameSender::run() {
+    Trace::setThreadName("sender");
+    std::string buffer;
+    std::vector<std::string> notes;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [this] { return stopping || (!down && !queue.empty()); });
+        if (queue.empty() || down) break; // stopping with nothing left to write
+
+        // Coalesce: every queued frame that fits goes out in one write
+        buffer.clear();
+        notes.clear();
+        size_t items = 0;
+        size_t frames = 0;
+        for (const Item& item : queue) {
+            if (items > 0 && buffer.size() + item.frame.size() + 1 > MAX_WRITE_BYTES) break;
+            if (item.heartBeat) {
+                buffer.push_back('\n');
+            } else {
+                buffer.append(item.frame).push_back('\0');
+                ++frames;
+            }
+            if (!item.note.empty()) notes.push_back(item.note);
+            ++items;
+        }
+        writing = true;
+        ConnectionHandler* target = connection;
+        lock.unlock();
+
+        bool written;
+        {
+            TraceSpan span("socket write");
+            written = target->sendBytes(buffer.data(), static_cast<int>(buffer.size()));
+        }
+
+        lock.lock();
+        writing = false;
+        if (written) {
+            for (size_t i = 0; i < items; ++i) {
+                queuedBytes -= queue.front().frame.size() + 1;
+                queue.pop_front();
+            }
+            Metrics::increment(Metrics::FramesSent, frames);
+            if (queue.empty()) fullReported = false;
+            for (const std::string& note : notes) std::cout << note << "\n";
+        } else if (target == connection && !down) {
+            // Frames of a failed write are kept if held; the server may see some of them twice
+            target->shutdown();
+            down = true;
+            dropUnheld();
+        }
+        changed.notify_all();
+    }
+}
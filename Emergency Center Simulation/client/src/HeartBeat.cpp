@@ -0,0 +1,83 @@
+#include "../include/HeartBeat.h"
+#include "../include/Metrics.h"
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+
+constexpr double HeartBeat::RECEIVE_GRACE;
+
+namespace {
+
+std::chrono::milliseconds since(uint64_t nanos) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::nanoseconds(Metrics::now() - nanos));
+}
+
+// "cx,cy" as sent in a heart-beat header; false if malformed
+bool parseHeader(const std::string& value, long& first, long& second) {
+    const char* end = value.data() + value.size();
+    auto result = std::from_chars(value.data(), end, first);
+    if (result.ec != std::errc() || result.ptr == end || *result.ptr != ',') return false;
+    result = std::from_chars(result.ptr + 1, end, second);
+    return result.ec == std::errc() && result.ptr == end && first >= 0 && second >= 0;
+}
+
+// Zero unless both sides are willing, otherwise the slower of the two
+std::chrono::milliseconds agree(std::chrono::milliseconds ours, long theirs) {
+    if (ours.count() == 0 || theirs == 0) return std::chrono::milliseconds(0);
+    return std::max(ours, std::chrono::milliseconds(theirs));
+}
+
+} // namespace
+
+HeartBeat::HeartBeat(TimerWheel& wheel)
+    : wheel(wheel), sendTimer([this] { return onSendTimer(); }), receiveTimer([this] { return onReceiveTimer(); }),
+      connection(nullptr), sender(nullptr), sendInterval(0), receiveInterval(0) {}
+
+HeartBeat::~HeartBeat() {
+    stop();
+}
+
+std::string HeartBeat::offer(std::chrono::milliseconds send, std::chrono::milliseconds receive) {
+    return "heart-beat:" + std::to_string(send.count()) + "," + std::to_string(receive.count()) + "\n";
+}
+
+void HeartBeat::start(ConnectionHandler* newConnection, FrameSender& newSender, std::chrono::milliseconds send,
+                      std::chrono::milliseconds receive, const std::string& serverHeader) {
+    stop();
+    long serverSend = 0;
+    long serverReceive = 0;
+    if (!serverHeader.empty() && !parseHeader(serverHeader, serverSend, serverReceive)) {
+        std::cerr << "Ignoring malformed heart-beat header: " << serverHeader << std::endl;
+    }
+    connection = newConnection;
+    sender = &newSender;
+    // We send as often as the server asks, but not more often than we offered; likewise for receiving
+    sendInterval = agree(send, serverReceive);
+    receiveInterval = agree(receive, serverSend);
+    if (sendInterval.count() > 0) wheel.schedule(sendTimer, sendInterval);
+    if (receiveInterval.count() > 0) {
+        wheel.schedule(receiveTimer, std::chrono::duration_cast<std::chrono::milliseconds>(receiveInterval * RECEIVE_GRACE));
+    }
+}
+
+void HeartBeat::stop() {
+    wheel.cancel(sendTimer);
+    wheel.cancel(receiveTimer);
+}
+
+std::chrono::milliseconds HeartBeat::onSendTimer() {
+    std::chrono::milliseconds idle = since(connection->lastSendTime());
+    if (idle < sendInterval) return sendInterval - idle;
+    if (sender->sendHeartBeat()) Metrics::increment(Metrics::HeartBeatsSent);
+    return sendInterval;
+}
+
+std::chrono::milliseconds HeartBeat::onReceiveTimer() {
+    std::chrono::milliseconds limit = std::chrono::duration_cast<std::chrono::milliseconds>(receiveInterval * RECEIVE_GRACE);
+    std::chrono::milliseconds silent = since(connection->lastReceiveTime());
+    if (silent < limit) return limit - silent;
+    Metrics::increment(Metrics::HeartBeatTimeouts);
+    std::cerr << "No heart-beat from server for " << silent.count() << " ms.\n";
+    connection->shutdown();
+    return std::chrono::milliseconds(0);
+}
@@ -0,0 +1,183 @@
+#include "../include/Metrics.h"
+#include <sstream>
+
+struct Metrics::Shard {
+    std::atomic<uint64_t> counters[COUNTER_COUNT];
+    std::atomic<uint64_t> sums[HISTOGRAM_COUNT];
+    std::atomic<uint64_t> buckets[HISTOGRAM_COUNT][BUCKET_COUNT];
+
+    Shard() : counters(), sums(), buckets() {
+        for (auto& counter : counters) counter.store(0, std::memory_order_relaxed);
+        for (auto& sum : sums) sum.store(0, std::memory_order_relaxed);
+        for (auto& histogram : buckets) {
+            for (auto& bucket : histogram) bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Adds every cell into total and zeroes it. Called under registryMutex.
+    void drainInto(Shard& total) {
+        auto move = [](std::atomic<uint64_t>& from, std::atomic<uint64_t>& to) {
+            to.store(to.load(std::memory_order_relaxed) + from.exchange(0, std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+        };
+        for (int c = 0; c < COUNTER_COUNT; ++c) move(counters[c], total.counters[c]);
+        for (int h = 0; h < HISTOGRAM_COUNT; ++h) {
+            move(sums[h], total.sums[h]);
+            for (int b = 0; b < BUCKET_COUNT; ++b) move(buckets[h][b], total.buckets[h][b]);
+        }
+    }
+};
+
+// A thread's claim on a shard, given back when the thread exits
+struct Metrics::ShardLease {
+    Shard* shard;
+    ShardLease() : shard(nullptr) {}
+    ~ShardLease() {
+        if (shard != nullptr) release(*shard);
+    }
+    ShardLease(const ShardLease&) = delete;
+    ShardLease& operator=(const ShardLease&) = delete;
+};
+
+namespace {
+
+// Only the owning thread writes a shard, so a plain load + store is enough;
+// the atomics just keep concurrent snapshot reads well defined.
+inline void add(std::atomic<uint64_t>& cell, uint64_t amount) {
+    cell.store(cell.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+} // namespace
+
+std::mutex Metrics::registryMutex;
+
+const char* Metrics::name(Counter counter) {
+    static const char* names[COUNTER_COUNT] = {
+        "frames received", "frames sent", "bytes received", "bytes sent",
+        "socket reads", "socket writes", "reports stored", "reconnects", "frames held",
+        "heart-beats sent", "heart-beat timeouts"};
+    return names[counter];
+}
+
+const char* Metrics::name(Histogram histogram) {
+    static const char* names[HISTOGRAM_COUNT] = {
+        "parse", "store", "protocol lock wait", "shared data lock wait", "command",
+        "event file parse", "report send", "send queue wait"};
+    return names[histogram];
+}
+
+// Every shard ever handed out. Threads come and go with each login, reconnect and
+// summary-all, so a shard is recycled once its thread exits: what the thread
+// recorded moves into retired() and the zeroed shard waits in freeShards().
+std::vector<std::unique_ptr<Metrics::Shard>>& Metrics::registry() {
+    static std::vector<std::unique_ptr<Shard>> shards;
+    return shards;
+}
+
+std::vector<Metrics::Shard*>& Metrics::freeShards() {
+    static std::vector<Shard*> shards;
+    return shards;
+}
+
+Metrics::Shard& Metrics::retired() {
+    static Shard totals;
+    return totals;
+}
+
+Metrics::Shard& Metrics::localShard() {
+    thread_local ShardLease lease;
+    if (lease.shard == nullptr) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        if (!freeShards().empty()) {
+            lease.shard = freeShards().back();
+            freeShards().pop_back();
+        } else {
+            registry().push_back(std::make_unique<Shard>());
+            lease.shard = registry().back().get();
+        }
+    }
+    return *lease.shard;
+}
+
+void Metrics::release(Shard& shard) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    shard.drainInto(retired());
+    freeShards().push_back(&shard);
+}
+
+int Metrics::bucketOf(uint64_t value) {
+    if (value < SUB_BUCKETS) return static_cast<int>(value);
+    int exponent = 63 - __builtin_clzll(value);
+    int shift = exponent - SUB_BUCKET_BITS;
+    return ((shift + 1) << SUB_BUCKET_BITS) + static_cast<int>((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t Metrics::bucketUpperBound(int bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    int shift = (bucket >> SUB_BUCKET_BITS) - 1;
+    uint64_t base = static_cast<uint64_t>(SUB_BUCKETS + (bucket & (SUB_BUCKETS - 1))) << shift;
+    return base + ((uint64_t(1) << shift) - 1);
+}
+
+void Metrics::increment(Counter counter, uint64_t amount) {
+    add(localShard().counters[counter], amount);
+}
+
+void Metrics::record(Histogram histogram, uint64_t nanos) {
+    Shard& shard = localShard();
+    add(shard.sums[histogram], nanos);
+    add(shard.buckets[histogram][bucketOf(nanos)], 1);
+}
+
+uint64_t Metrics::HistogramSnapshot::percentile(double quantile) const {
+    if (count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(quantile * (count - 1)) + 1;
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        seen += buckets[bucket];
+        if (seen >= rank) return bucketUpperBound(bucket);
+    }
+    return bucketUpperBound(BUCKET_COUNT - 1);
+}
+
+Metrics::Snapshot Metrics::snapshot() {
+    Snapshot result{};
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::vector<const Shard*> shards{&retired()};
+    for (const auto& shard : registry()) shards.push_back(shard.get());
+    for (const Shard* shard : shards) {
+        for (int c = 0; c < COUNTER_COUNT; ++c) {
+            result.counters[c] += shard->counters[c].load(std::memory_order_relaxed);
+        }
+        for (int h = 0; h < HISTOGRAM_COUNT; ++h) {
+            HistogramSnapshot& histogram = result.histograms[h];
+            histogram.sum += shard->sums[h].load(std::memory_order_relaxed);
+            for (int b = 0; b < BUCKET_COUNT; ++b) {
+                uint64_t hits = shard->buckets[h][b].load(std::memory_order_relaxed);
+                histogram.buckets[b] += hits;
+                histogram.count += hits;
+            }
+        }
+    }
+    return result;
+}
+
+std::string Metrics::format(const Snapshot& snapshot) {
+    std::ostringstream out;
+    for (int c = 0; c < COUNTER_COUNT; ++c) {
+        out << name(static_cast<Counter>(c)) << ": " << snapshot.counters[c] << "\n";
+    }
+    for (int h = 0; h < HISTOGRAM_COUNT; ++h) {
+        const HistogramSnapshot& histogram = snapshot.histograms[h];
+        out << name(static_cast<Histogram>(h)) << " (ns): count " << histogram.count;
+        if (histogram.count != 0) {
+            out << ", mean " << histogram.sum / histogram.count
+                << ", p50 " << histogram.percentile(0.5)
+                << ", p90 " << histogram.percentile(0.9)
+                << ", p99 " << histogram.percentile(0.99)
+                << ", max " << histogram.percentile(1.0);
+        }
+        out << "\n";
+    }
+    return out.str();
+}
@@ -0,0 +1,63 @@
+#include "../include/EventSource.h"
+#include "../include/json.hpp"
+#include <fstream>
+
+using json = nlohmann::json;
+
+names_and_events NlohmannEventSource::load(const std::string& path)
+{
+    std::ifstream f(path);
+    if (!f) {
+        throw std::runtime_error("Error: File not found or cannot be opened - " + path);
+    }
+
+    json data;
+    try {
+        data = json::parse(f); // Parse the JSON file
+    } catch (const json::parse_error& e) {
+        throw std::runtime_error("JSON parse error: " + std::string(e.what()));
+    }
+
+    // Extract the channel name
+    std::string channel_name = data["channel_name"];
+
+    // Convert the events into Event objects
+    std::vector<Event> events;
+    try {
+        events.reserve(data["events"].size());
+        for (const auto& event : data["events"]) {
+            std::string name = event["event_name"];
+            std::string city = event["city"];
+            int date_time = event["date_time"];
+            std::string description = event["description"];
+            std::map<std::string, DetailValue> general_information;
+
+            // Values keep their JSON kind; null, arrays and objects are kept as their text
+            for (const auto& update : event["general_information"].items()) {
+                const auto& value = update.value();
+                DetailValue detail;
+                if (value.is_string()) {
+                    detail = DetailValue::fromString(value.get_ref<const std::string&>());
+                } else if (value.is_boolean()) {
+                    detail = DetailValue::fromBool(value.get<bool>());
+                } else if (value.is_number_unsigned() && value.get<uint64_t>() > uint64_t(INT64_MAX)) {
+                    detail = DetailValue::fromDouble(value.get<double>());
+                } else if (value.is_number_integer()) {
+                    detail = DetailValue::fromInt(value.get<int64_t>());
+                } else if (value.is_number_float()) {
+                    detail = DetailValue::fromDouble(value.get<double>());
+                } else {
+                    detail = DetailValue::fromString(value.dump());
+                }
+                general_information[update.key()] = detail;
+            }
+
+            events.emplace_back(channel_name, std::move(city), std::move(name), date_time, std::move(description),
+                                std::move(general_information));
+        }
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Error processing events: " + std::string(e.what()));
+    }
+
+    return names_and_events{std::move(channel_name), std::move(events)};
+}
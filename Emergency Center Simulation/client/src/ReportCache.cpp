@@ -0,0 +1,240 @@
+#include "../include/ReportCache.h"
+#include "../include/ReportCodec.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+
+namespace {
+
+// A cache file, all integers little-endian like BinaryEventFile:
+//
+//   "EMIC" | u32 version | u64 size | i64 modified | u32 path length | path |
+//   u32 destination length | destination | u32 count | count x u32 body length | bodies
+const char CACHE_MAGIC[4] = {'E', 'M', 'I', 'C'};
+const uint32_t CACHE_VERSION = 1;
+
+void putU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+void putU64(std::string& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+// Bounds-checked reader over a whole cache file; reading past the end clears ok
+class Reader {
+private:
+    std::string_view data;
+    size_t pos;
+
+    uint64_t number(size_t width) {
+        std::string_view view = bytes(width);
+        uint64_t value = 0;
+        for (size_t i = 0; i < view.size(); ++i) value |= uint64_t(static_cast<unsigned char>(view[i])) << (8 * i);
+        return value;
+    }
+
+public:
+    bool ok;
+
+    explicit Reader(std::string_view data) : data(data), pos(0), ok(true) {}
+
+    std::string_view bytes(size_t length) {
+        if (!ok || data.size() - pos < length) {
+            ok = false;
+            return std::string_view();
+        }
+        std::string_view view = data.substr(pos, length);
+        pos += length;
+        return view;
+    }
+
+    uint32_t u32() { return static_cast<uint32_t>(number(4)); }
+    uint64_t u64() { return number(8); }
+    bool atEnd() const { return pos == data.size(); }
+};
+
+// FNV-1a, so a path maps to the same file name in every run
+uint64_t hashPath(const std::string& path) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : path) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+} // namespace
+
+EncodedEvents EncodedEvents::encode(const names_and_events& data) {
+    EncodedEvents events;
+    events.destination = "/" + data.channel_name;
+    events.ends.reserve(data.events.size());
+    for (const Event& event : data.events) {
+        ReportCodec::encodeWithoutUser(event, events.bodies);
+        events.ends.push_back(events.bodies.size());
+    }
+    return events;
+}
+
+std::string_view EncodedEvents::body(size_t i) const {
+    size_t start = i == 0 ? 0 : ends[i - 1];
+    return std::string_view(bodies).substr(start, ends[i] - start);
+}
+
+ReportCache::ReportCache()
+    : cache(), maxBytes(DEFAULT_MAX_BYTES), totalBytes(0), useClock(0), hitCount(0), missCount(0), directory("") {}
+
+constexpr size_t ReportCache::DEFAULT_MAX_BYTES;
+
+bool ReportCache::stamp(const std::string& path, FileStamp& stamp) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+    stamp.size = static_cast<uint64_t>(st.st_size);
+    stamp.modified = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+const EncodedEvents* ReportCache::find(const std::string& path, const FileStamp& stamp) {
+    auto it = cache.find(path);
+    if (it != cache.end()) {
+        if (it->second.stamp == stamp) {
+            it->second.lastUse = ++useClock;
+            ++hitCount;
+            return &it->second.events;
+        }
+        // The file changed since it was cached
+        totalBytes -= it->second.bytes;
+        cache.erase(it);
+    }
+
+    EncodedEvents events;
+    if (!directory.empty() && load(path, stamp, events)) {
+        const EncodedEvents* stored = store(path, stamp, std::move(events));
+        if (stored != nullptr) {
+            ++hitCount;
+            return stored;
+        }
+    }
+    ++missCount;
+    return nullptr;
+}
+
+const EncodedEvents* ReportCache::insert(const std::string& path, const FileStamp& stamp, EncodedEvents&& events) {
+    if (!directory.empty()) save(path, stamp, events);
+    return store(path, stamp, std::move(events));
+}
+
+const EncodedEvents* ReportCache::store(const std::string& path, const FileStamp& stamp, EncodedEvents&& events) {
+    size_t bytes = sizeof(Entry) + path.size() + events.destination.size() + events.bodies.capacity() +
+                   events.ends.capacity() * sizeof(size_t);
+    if (bytes > maxBytes) return nullptr;
+
+    auto existing = cache.find(path);
+    if (existing != cache.end()) {
+        totalBytes -= existing->second.bytes;
+        cache.erase(existing);
+    }
+    // A handful of files at most, so finding the least recently used one is a scan
+    while (totalBytes + bytes > maxBytes) {
+        auto oldest = std::min_element(cache.begin(), cache.end(), [](const auto& a, const auto& b) {
+            return a.second.lastUse < b.second.lastUse;
+        });
+        totalBytes -= oldest->second.bytes;
+        cache.erase(oldest);
+    }
+
+    Entry& entry = cache[path];
+    entry.stamp = stamp;
+    entry.events = std::move(events);
+    entry.bytes = bytes;
+    entry.lastUse = ++useClock;
+    totalBytes += bytes;
+    return &entry.events;
+}
+
+void ReportCache::clear() {
+    cache.clear();
+    totalBytes = 0;
+}
+
+bool ReportCache::setDirectory(const std::string& path) {
+    if (!path.empty()) {
+        struct stat st;
+        if (::mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        if (::stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return false;
+    }
+    directory = path;
+    return true;
+}
+
+std::string ReportCache::fileFor(const std::string& path) const {
+    char name[24];
+    std::snprintf(name, sizeof(name), "%016llx.emic", static_cast<unsigned long long>(hashPath(path)));
+    return directory + "/" + name;
+}
+
+bool ReportCache::load(const std::string& path, const FileStamp& stamp, EncodedEvents& events) const {
+    std::ifstream f(fileFor(path), std::ios::binary | std::ios::ate);
+    if (!f) return false;
+    std::string content(static_cast<size_t>(f.tellg()), '\0');
+    f.seekg(0);
+    if (!f.read(&content[0], content.size())) return false;
+
+    Reader reader(content);
+    if (reader.bytes(sizeof(CACHE_MAGIC)) != std::string_view(CACHE_MAGIC, sizeof(CACHE_MAGIC))) return false;
+    if (reader.u32() != CACHE_VERSION) return false;
+    FileStamp saved;
+    saved.size = reader.u64();
+    saved.modified = static_cast<int64_t>(reader.u64());
+    // Two paths can share a file name; the path inside tells them apart
+    if (!(saved == stamp) || reader.bytes(reader.u32()) != path) return false;
+    events.destination.assign(reader.bytes(reader.u32()));
+
+    // Each body costs at least its 4 byte length, which bounds the reserve on a damaged count
+    uint32_t count = reader.u32();
+    if (!reader.ok || count > content.size() / 4) return false;
+    events.ends.reserve(count);
+    size_t end = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        end += reader.u32();
+        events.ends.push_back(end);
+    }
+    events.bodies.assign(reader.bytes(end));
+    return reader.ok && reader.atEnd();
+}
+
+void ReportCache::save(const std::string& path, const FileStamp& stamp, const EncodedEvents& events) const {
+    std::string header(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    putU32(header, CACHE_VERSION);
+    putU64(header, stamp.size);
+    putU64(header, static_cast<uint64_t>(stamp.modified));
+    putU32(header, static_cast<uint32_t>(path.size()));
+    header.append(path);
+    putU32(header, static_cast<uint32_t>(events.destination.size()));
+    header.append(events.destination);
+    putU32(header, static_cast<uint32_t>(events.size()));
+    size_t start = 0;
+    for (size_t end : events.ends) {
+        putU32(header, static_cast<uint32_t>(end - start));
+        start = end;
+    }
+
+    // Written aside and renamed over the old one, so a concurrent run never reads half a file
+    std::string file = fileFor(path);
+    std::string temporary = file + ".tmp";
+    bool written;
+    {
+        std::ofstream f(temporary, std::ios::binary | std::ios::trunc);
+        f.write(header.data(), header.size());
+        f.write(events.bodies.data(), events.bodies.size());
+        written = static_cast<bool>(f);
+    }
+    if (!written || std::rename(temporary.c_str(), file.c_str()) != 0) {
+        std::cerr << "Cannot write report cache file " << file << "\n";
+        std::remove(temporary.c_str());
+    }
+}
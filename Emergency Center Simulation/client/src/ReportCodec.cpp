@@ -0,0 +1,137 @@
+#include "../include/ReportCodec.h"
+#include "../include/ParseNumber.h"
+#include <cstring>
+
+namespace {
+
+// The decoder runs on every report received; these work on pointers rather than
+// string_view members, which cost a call per character in an unoptimised build
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// [first, last) without its leading and trailing blanks
+std::string_view trim(const char* first, const char* last) {
+    while (first != last && isBlank(*first)) ++first;
+    while (last != first && isBlank(last[-1])) --last;
+    return std::string_view(first, last - first);
+}
+
+// Takes the line at pos off [pos, last), trimmed and without its '\n'
+std::string_view takeLine(const char*& pos, const char* last) {
+    const char* lineEnd = static_cast<const char*>(std::memchr(pos, '\n', last - pos));
+    std::string_view line = trim(pos, lineEnd == nullptr ? last : lineEnd);
+    pos = lineEnd == nullptr ? last : lineEnd + 1;
+    return line;
+}
+
+// Splits line at its first ':' into a trimmed field and value; false if it has no ':'
+bool splitField(std::string_view line, std::string_view& field, std::string_view& value) {
+    const char* colon = static_cast<const char*>(std::memchr(line.data(), ':', line.size()));
+    if (colon == nullptr) return false;
+    field = trim(line.data(), colon);
+    value = trim(colon + 1, line.data() + line.size());
+    return true;
+}
+
+template <size_t N>
+bool is(std::string_view text, const char (&name)[N]) {
+    return text.size() == N - 1 && std::memcmp(text.data(), name, N - 1) == 0;
+}
+
+} // namespace
+
+void ReportCodec::encode(const std::string& user, const Event& event, std::string& out) {
+    out.append("user:").append(user);
+    encodeWithoutUser(event, out);
+}
+
+void ReportCodec::encodeWithoutUser(const Event& event, std::string& out) {
+    char dateTime[24];
+    auto dateTimeEnd = std::to_chars(dateTime, dateTime + sizeof(dateTime), event.get_date_time()).ptr;
+
+    size_t size = 96 + event.get_city().size() + event.get_name().size() + event.get_description().size();
+    for (const auto& [key, value] : event.get_general_information()) {
+        size += 10 + key.size() + (value.kind() == DetailValue::String ? value.asString().size() : 24);
+    }
+    out.reserve(out.size() + size);
+
+    out.append("\ncity:").append(event.get_city());
+    out.append("\nevent name:").append(event.get_name());
+    out.append("\ndate time:").append(dateTime, dateTimeEnd);
+    out.append("\ngeneral information:\n");
+    for (const auto& [key, value] : event.get_general_information()) {
+        out.append("        ").append(key).append(":");
+        value.appendTo(out);
+        out.push_back('\n');
+    }
+    out.append("description:\n").append(event.get_description()).append("\n");
+}
+
+bool ReportCodec::decode(std::string_view body, Report& report) {
+    const char* pos = body.data();
+    const char* const end = pos + body.size();
+    bool inGeneralInformation = false;
+    std::string_view field;
+    std::string_view value;
+    while (pos != end) {
+        if (!splitField(takeLine(pos, end), field, value)) continue;
+
+        if (is(field, "description")) {
+            // The rest of the body is the description; it only gets shorter for being trimmed
+            report.description.reserve(value.size() + (end - pos));
+            report.description.assign(value.data(), value.size());
+            while (pos != end) {
+                std::string_view line = takeLine(pos, end);
+                if (line.empty()) continue;
+                if (!report.description.empty()) report.description += ' ';
+                report.description.append(line.data(), line.size());
+            }
+        } else if (inGeneralInformation) {
+            // encode writes the details in key order, so the end is the right hint
+            report.details.insert_or_assign(report.details.end(), std::string(field), DetailValue::parse(value));
+        } else if (is(field, "user")) {
+            report.user.assign(value.data(), value.size());
+        } else if (is(field, "city")) {
+            report.city.assign(value.data(), value.size());
+        } else if (is(field, "event name")) {
+            report.eventName.assign(value.data(), value.size());
+        } else if (is(field, "date time")) {
+            if (!parseNumber(value, report.dateTime)) return false;
+        } else if (is(field, "general information")) {
+            inGeneralInformation = true;
+        }
+    }
+    return !report.user.empty();
+}
+
+bool ReportCodec::scan(std::string_view body, ReportHeader& header) {
+    const char* pos = body.data();
+    const char* const end = pos + body.size();
+    bool inGeneralInformation = false;
+    std::string_view field;
+    std::string_view value;
+    while (pos != end) {
+        if (!splitField(takeLine(pos, end), field, value)) continue;
+
+        if (is(field, "description")) {
+            break;
+        } else if (inGeneralInformation) {
+            // Later entries win, as in decode
+            if (is(field, "active")) header.active = is(value, "true");
+            else if (is(field, "forces_arrival_at_scene")) header.forcesArrived = is(value, "true");
+        } else if (is(field, "user")) {
+            header.userOffset = static_cast<uint32_t>(value.data() - body.data());
+            header.userLength = static_cast<uint32_t>(value.size());
+        } else if (is(field, "city")) {
+            header.cityOffset = static_cast<uint32_t>(value.data() - body.data());
+            header.cityLength = static_cast<uint32_t>(value.size());
+        } else if (is(field, "date time")) {
+            if (!parseNumber(value, header.dateTime)) return false;
+        } else if (is(field, "general information")) {
+            inGeneralInformation = true;
+        }
+    }
+    return header.userLength != 0;
+}
@@ -0,0 +1,310 @@
+#include "../include/ReportStore.h"
+#include "../include/ReportCodec.h"
+#include <algorithm>
+#include <climits>
+
+ReportQuery::ReportQuery()
+    : user(""), city(""), eventName(""), from(LONG_MIN), to(LONG_MAX), details() {}
+
+ReportStore::ReportStore()
+    : reports(), firstSeq(0), decoded(), firstDecoded(0), byTime(), staleTimeEntries(0), byUser(), byCity(), arena(),
+      firstChunk(0), indexKey(), retention(), bytes(0), evicted(0) {}
+
+constexpr size_t ReportStore::ARENA_CHUNK_SIZE;
+
+// Rough heap cost of a decoded report: its slots, string buffers that outgrew the
+// small string optimisation, one tree node per detail and its index entries.
+// Short detail strings are interned and shared; longer ones are counted whole.
+size_t ReportStore::footprint(const Report& report) {
+    auto heap = [](const std::string& s) { return s.capacity() > 15 ? s.capacity() + 1 : 0; };
+    size_t total = sizeof(StoredReport) + sizeof(Report) + sizeof(std::pair<long, size_t>) + 2 * sizeof(size_t);
+    total += heap(report.user) + heap(report.eventName) + heap(report.city) + heap(report.description);
+    for (const auto& entry : report.details) {
+        total += sizeof(std::pair<const std::string, DetailValue>) + 4 * sizeof(void*);
+        total += heap(entry.first);
+        if (entry.second.kind() == DetailValue::String && entry.second.asString().size() > DetailValue::MAX_INTERNED_LENGTH)
+            total += entry.second.asString().capacity() + 1;
+    }
+    return total;
+}
+
+const ReportStore::StoredReport& ReportStore::at(size_t seq) const {
+    return reports[seq - firstSeq];
+}
+
+const Report& ReportStore::decodedReport(const StoredReport& stored) const {
+    return decoded[stored.chunk - firstDecoded];
+}
+
+bool ReportStore::decode(const StoredReport& stored, Report& report) const {
+    std::string_view chunk = arena[stored.chunk - firstChunk];
+    return ReportCodec::decode(chunk.substr(stored.offset, stored.length), report);
+}
+
+void ReportStore::insert(StoredReport& stored, std::string_view user, std::string_view city, long now) {
+    size_t seq = firstSeq + reports.size();
+    // Looked up through indexKey, whose buffer is reused, so a known user or city costs no allocation
+    indexKey.assign(user);
+    auto userPostings = byUser.try_emplace(indexKey).first;
+    userPostings->second.push_back(seq);
+    stored.user = &userPostings->first;
+    indexKey.assign(city);
+    auto cityPostings = byCity.try_emplace(indexKey).first;
+    cityPostings->second.push_back(seq);
+    stored.city = &cityPostings->first;
+
+    stored.receivedAt = now;
+    bytes += stored.bytes;
+    reports.push_back(stored);
+}
+
+void ReportStore::append(Report report, long now) {
+    StoredReport stored;
+    stored.dateTime = report.dateTime;
+    stored.bytes = footprint(report);
+    stored.chunk = firstDecoded + decoded.size();
+    decoded.push_back(std::move(report));
+    const Report& kept = decodedReport(stored);
+    insert(stored, kept.user, kept.city, now);
+}
+
+void ReportStore::append(const RawReport& raw, long now) {
+    if (arena.empty() || arena.back().size() + raw.body.size() > arena.back().capacity()) {
+        arena.emplace_back();
+        arena.back().reserve(std::max(ARENA_CHUNK_SIZE, raw.body.size()));
+    }
+    StoredReport stored;
+    stored.dateTime = raw.header.dateTime;
+    stored.active = raw.header.active;
+    stored.forcesArrived = raw.header.forcesArrived;
+    stored.raw = true;
+    stored.chunk = firstChunk + arena.size() - 1;
+    stored.offset = arena.back().size();
+    stored.length = raw.body.size();
+    arena.back().append(raw.body);
+    stored.bytes = sizeof(StoredReport) + sizeof(std::pair<long, size_t>) + 2 * sizeof(size_t) + raw.body.size();
+    insert(stored, raw.header.user(raw.body), raw.header.city(raw.body), now);
+}
+
+void ReportStore::add(Report report, long now) {
+    // Reports mostly arrive in time order, so this is usually an append
+    auto pos = std::upper_bound(byTime.begin(), byTime.end(), report.dateTime,
+                                [](long dateTime, const std::pair<long, size_t>& entry) {
+                                    return dateTime < entry.first;
+                                });
+    byTime.insert(pos, {report.dateTime, firstSeq + reports.size()});
+    append(std::move(report), now);
+
+    enforceRetention(now);
+}
+
+void ReportStore::add(std::vector<Report>& batch, long now) {
+    addBatch(batch, now);
+}
+
+void ReportStore::add(std::vector<RawReport>& batch, long now) {
+    addBatch(batch, now);
+}
+
+template <typename T>
+void ReportStore::addBatch(std::vector<T>& batch, long now) {
+    size_t indexed = byTime.size();
+    reports.reserve(reports.size() + batch.size());
+    // An exact reserve would reallocate on every small batch; keep the growth geometric
+    if (byTime.capacity() < byTime.size() + batch.size()) {
+        byTime.reserve(std::max(byTime.size() + batch.size(), 2 * byTime.capacity()));
+    }
+    for (T& report : batch) {
+        append(std::move(report), now);
+        byTime.emplace_back(reports[reports.size() - 1].dateTime, firstSeq + reports.size() - 1);
+    }
+    batch.clear();
+
+    // Stable, so equal dateTimes keep arrival order as the upper_bound insert in add does
+    auto earlier = [](const std::pair<long, size_t>& a, const std::pair<long, size_t>& b) { return a.first < b.first; };
+    auto middle = byTime.begin() + indexed;
+    if (!std::is_sorted(middle, byTime.end(), earlier)) std::stable_sort(middle, byTime.end(), earlier);
+    if (middle != byTime.begin() && middle != byTime.end() && earlier(*middle, *(middle - 1))) {
+        // Merge from the back: the older entries after each new one move up as one block, and
+        // every entry moves at most once, where an insert per report would shift them each time
+        std::vector<std::pair<long, size_t>> added(middle, byTime.end());
+        auto write = byTime.end();
+        auto older = middle;
+        for (auto entry = added.rbegin(); entry != added.rend(); ++entry) {
+            auto after = std::upper_bound(byTime.begin(), older, *entry, earlier);
+            write = std::move_backward(after, older, write);
+            older = after;
+            *--write = *entry;
+        }
+    }
+
+    enforceRetention(now);
+}
+
+void ReportStore::evictOldest() {
+    StoredReport& oldest = reports.front();
+
+    auto user = byUser.find(*oldest.user);
+    user->second.pop_front();
+    if (user->second.empty()) byUser.erase(user);
+    auto city = byCity.find(*oldest.city);
+    city->second.pop_front();
+    if (city->second.empty()) byCity.erase(city);
+
+    // Bodies are in sequence order: once the last one in a chunk that is no longer appended to
+    // goes, nothing refers to that chunk or the ones before it
+    if (oldest.raw && oldest.chunk + 1 < firstChunk + arena.size() &&
+        oldest.offset + oldest.length == arena[oldest.chunk - firstChunk].size()) {
+        while (firstChunk <= oldest.chunk) {
+            arena.pop_front();
+            ++firstChunk;
+        }
+    }
+
+    if (!oldest.raw) {
+        decoded.pop_front();
+        ++firstDecoded;
+    }
+    bytes -= oldest.bytes;
+    reports.pop_front();
+    ++firstSeq;
+    ++evicted;
+    if (reports.empty()) {
+        firstChunk += arena.size();
+        arena.clear();
+    }
+
+    // The time index is not in sequence order; compact it once half of it is stale
+    if (++staleTimeEntries > byTime.size() / 2) {
+        size_t first = firstSeq;
+        byTime.erase(std::remove_if(byTime.begin(), byTime.end(),
+                                    [first](const std::pair<long, size_t>& entry) { return entry.second < first; }),
+                     byTime.end());
+        staleTimeEntries = 0;
+    }
+}
+
+void ReportStore::enforceRetention(long now) {
+    while (!reports.empty()) {
+        const StoredReport& oldest = reports.front();
+        bool overCount = retention.maxReports != 0 && reports.size() > retention.maxReports;
+        bool overBytes = retention.maxBytes != 0 && bytes > retention.maxBytes;
+        bool tooOld = retention.maxAgeSeconds != 0 && now - oldest.receivedAt > retention.maxAgeSeconds;
+        if (!overCount && !overBytes && !tooOld) break;
+        evictOldest();
+    }
+}
+
+void ReportStore::setRetention(const RetentionPolicy& policy, long now) {
+    retention = policy;
+    enforceRetention(now);
+}
+
+bool ReportStore::matches(const StoredReport& stored, const ReportQuery& query, Report& scratch) const {
+    if (stored.dateTime < query.from || stored.dateTime > query.to) return false;
+    if (!query.user.empty() && *stored.user != query.user) return false;
+    if (!query.city.empty() && *stored.city != query.city) return false;
+
+    const Report* report = stored.raw ? nullptr : &decodedReport(stored);
+    if (stored.raw) {
+        bool decodeNeeded = !query.eventName.empty();
+        for (const auto& [key, value] : query.details) {
+            if (key == "active" && value.isTrue()) {
+                if (!stored.active) return false;
+            } else if (key == "forces_arrival_at_scene" && value.isTrue()) {
+                if (!stored.forcesArrived) return false;
+            } else {
+                decodeNeeded = true;
+            }
+        }
+        if (!decodeNeeded) return true;
+        scratch = Report();
+        if (!decode(stored, scratch)) return false;
+        report = &scratch;
+    }
+    if (!query.eventName.empty() && report->eventName != query.eventName) return false;
+    for (const auto& [key, value] : query.details) {
+        auto it = report->details.find(key);
+        if (it == report->details.end() || it->second != value) return false;
+    }
+    return true;
+}
+
+std::vector<Report> ReportStore::query(const ReportQuery& query) const {
+    static const std::deque<size_t> empty;
+
+    // Time range candidates
+    auto first = std::lower_bound(byTime.begin(), byTime.end(), query.from,
+                                  [](const std::pair<long, size_t>& entry, long dateTime) {
+                                      return entry.first < dateTime;
+                                  });
+    auto last = std::upper_bound(first, byTime.end(), query.to,
+                                 [](long dateTime, const std::pair<long, size_t>& entry) {
+                                     return dateTime < entry.first;
+                                 });
+    size_t timeCandidates = last - first;
+
+    // Posting list candidates; the smallest one wins
+    const std::deque<size_t>* postings = nullptr;
+    if (!query.user.empty()) {
+        auto it = byUser.find(query.user);
+        postings = it == byUser.end() ? &empty : &it->second;
+    }
+    if (!query.city.empty()) {
+        auto it = byCity.find(query.city);
+        const std::deque<size_t>* cityPostings = it == byCity.end() ? &empty : &it->second;
+        if (postings == nullptr || cityPostings->size() < postings->size()) postings = cityPostings;
+    }
+
+    // A raw report decoded to be matched is not decoded again for the result
+    std::vector<Report> result;
+    Report scratch;
+    auto collect = [&](size_t seq) {
+        const StoredReport& stored = at(seq);
+        scratch.user.clear(); // marks scratch as not decoded for this report
+        if (!matches(stored, query, scratch)) return;
+        if (!stored.raw) {
+            result.push_back(decodedReport(stored));
+        } else if (!scratch.user.empty()) {
+            result.push_back(std::move(scratch));
+        } else {
+            result.emplace_back();
+            decode(stored, result.back());
+        }
+    };
+
+    if (postings != nullptr && postings->size() < timeCandidates) {
+        for (size_t seq : *postings) {
+            collect(seq);
+        }
+        std::stable_sort(result.begin(), result.end(), [](const Report& a, const Report& b) {
+            return a.dateTime < b.dateTime;
+        });
+    } else {
+        for (auto it = first; it != last; ++it) {
+            if (it->second >= firstSeq) collect(it->second);
+        }
+    }
+    return result;
+}
+
+std::vector<std::string> ReportStore::users() const {
+    std::vector<std::string> result;
+    result.reserve(byUser.size());
+    for (const auto& entry : byUser) {
+        result.push_back(entry.first);
+    }
+    return result;
+}
+
+size_t ReportStore::size() const {
+    return reports.size();
+}
+
+ReportStoreUsage ReportStore::usage() const {
+    ReportStoreUsage result;
+    result.reports = reports.size();
+    result.bytes = bytes;
+    result.evicted = evicted;
+    return result;
+}
@@ -2,26 +2,30 @@
 #include <string>
 #include "StompClient.h"
 #include <iostream>
-#include <json.hpp>
 #include <fstream>
+#include <iomanip>
 #include "event.h"
 #include "ConnectionHandler.h"
 #include "StompProtocol.h"
+#include "Metrics.h"
+#include "ParseNumber.h"
 
-
-using json = nlohmann::json;
 std::atomic<int> uniqueIdCounter(0); // Atomic counter for unique IDs
-std::unordered_map<std::string, int> channelToSubId; // Map to store channel to subscription ID
 
 StompClient::StompClient()
     : isLoggedIn(false), username(""), connectionHandler(nullptr),
-      protocol(nullptr), serverThread(), mutex(), sharedDataMutex() {}
+      protocol(nullptr), serverThread(), mutex(), sharedDataMutex(), dateFormatter(),
+      statsThread(), statsMutex(), statsCondition(), statsRunning(false), lastReceiptId(-1),
+      compressBodies(false), bodyCompressor(), lazyReports(false), cacheReports(true), reportCache(), host(""), port(0), passcode(""), socketOptions(), standbyConnection(nullptr),
+      connectionAttempt(nullptr), reconnectCondition(), sender(),
+      heartBeatSend(DEFAULT_HEART_BEAT), heartBeatReceive(DEFAULT_HEART_BEAT), heartBeat() {}
 
 StompClient::~StompClient() {
+    stopStatsDump();
     if (serverThread.joinable()) {
         serverThread.join();
     }
-    if (connectionHandler) delete connectionHandler;
+    releaseConnections();
     if (protocol) delete protocol;
 }
 
@@ -37,9 +41,37 @@ std::vector<std::string> StompClient::split(const std::string& input, char delim
     return tokens;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    // Batch mode: commands come from "--script {file}" and/or "-c {command}" arguments
+    std::vector<std::string> script;
+    bool batch = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--script" && i + 1 < argc) {
+            std::ifstream file(argv[++i]);
+            if (!file) {
+                std::cerr << "Error: Could not open script " << argv[i] << std::endl;
+                return 2;
+            }
+            std::string line;
+            while (std::getline(file, line)) {
+                script.push_back(line);
+            }
+            batch = true;
+        } else if (arg == "-c" && i + 1 < argc) {
+            script.push_back(argv[++i]);
+            batch = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--script {file}] [-c {command}]..." << std::endl;
+            return 2;
+        }
+    }
+
     try {
         StompClient client;
+        if (batch) {
+            return client.runBatch(script);
+        }
         client.start(); // Start the client to handle keyboard inputs
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
@@ -50,124 +82,233 @@ int main() {
 }
 
 void StompClient::start() {
+    Trace::setThreadName("keyboard");
     std::cout << "Client Started \n"; 
-    while (true) {
-        std::string input;
-        std::getline(std::cin, input);
-
-        std::vector<std::string> args = split(input, ' ');
-        if (args.empty()) continue;
-
-        std::string command = args[0];
-        if (command == "login") {
-            handleLogin(args);
-        } else if (command == "logout") {
-            handleLogout();
-        } else if (command == "join") {
-            handleJoin(args);
-        } else if (command == "exit") {
-            handleExit(args);
-        } else if (command == "report") {
-            handleReport(args);
-        } else if (command == "summary") {
-            handleSummary(args);
-        } else {
-            std::cerr << "Unknown command: " << command << std::endl;
+    std::string input;
+    while (std::getline(std::cin, input)) {
+        execute(input);
+    }
+    if (isLoggedIn) handleLogout();
+}
+
+// Runs the commands back to back, waiting for the server to acknowledge each
+// one that sends frames, so later commands see its effects. Stops at the first
+// failing command. Returns the process exit status.
+int StompClient::runBatch(const std::vector<std::string>& commands) {
+    Trace::setThreadName("keyboard");
+    int status = 0;
+    uint64_t batchStart = Metrics::now();
+    for (const std::string& line : commands) {
+        if (split(line, ' ').empty() || line[0] == '#') continue;
+
+        uint64_t start = Metrics::now();
+        bool ok = execute(line);
+        if (ok && protocol != nullptr) {
+            if (split(line, ' ')[0] == "login") {
+                ok = protocol->waitForConnected(BATCH_ACK_TIMEOUT);
+            } else if (lastReceiptId >= 0) {
+                ok = protocol->waitForReceipt(lastReceiptId, BATCH_ACK_TIMEOUT);
+            }
+            if (!ok) std::cerr << "No acknowledgement from server.\n";
         }
+        double millis = (Metrics::now() - start) / 1e6;
+        std::cout << "[batch] " << (ok ? "ok    " : "FAILED") << " " << std::fixed << std::setprecision(3)
+                  << millis << " ms  " << line << "\n";
+        if (!ok) {
+            status = 1;
+            break;
+        }
+    }
+    if (isLoggedIn) handleLogout();
+    std::cout << "[batch] total " << std::fixed << std::setprecision(3) << (Metrics::now() - batchStart) / 1e6
+              << " ms, exit status " << status << "\n";
+    return status;
+}
+
+// The trace span name for command. Only the commands the client knows are named, so typed
+// input cannot grow the set of names for as long as the process runs.
+static const char* commandSpanName(const std::string& command) {
+    static const char* const commands[] = {"login", "logout", "join", "exit", "report", "generate", "summary",
+                                           "summary-all", "query", "retention", "memory", "stats", "trace",
+                                           "compress", "lazy", "cache", "heartbeat", "socket"};
+    for (const char* name : commands) {
+        if (command == name) return name;
+    }
+    return "unknown command";
+}
+
+bool StompClient::execute(const std::string& input) {
+    std::vector<std::string> args = split(input, ' ');
+    if (args.empty()) return true;
+
+    std::string command = args[0];
+    ScopedTimer timer(Metrics::CommandTime);
+    TraceSpan span(Trace::enabled() ? commandSpanName(command) : "");
+    lastReceiptId = -1;
+    if (command == "login") {
+        return handleLogin(args);
+    } else if (command == "logout") {
+        return handleLogout();
+    } else if (command == "join") {
+        return handleJoin(args);
+    } else if (command == "exit") {
+        return handleExit(args);
+    } else if (command == "report") {
+        return handleReport(args);
+    } else if (command == "generate") {
+        return handleGenerate(args);
+    } else if (command == "summary") {
+        return handleSummary(args);
+    } else if (command == "summary-all") {
+        return handleSummaryAll(args);
+    } else if (command == "query") {
+        return handleQuery(args);
+    } else if (command == "retention") {
+        return handleRetention(args);
+    } else if (command == "memory") {
+        return handleMemory();
+    } else if (command == "stats") {
+        return handleStats(args);
+    } else if (command == "trace") {
+        return handleTrace(args);
+    } else if (command == "compress") {
+        return handleCompress(args);
+    } else if (command == "lazy") {
+        return handleLazy(args);
+    } else if (command == "cache") {
+        return handleCache(args);
+    } else if (command == "heartbeat") {
+        return handleHeartBeat(args);
+    } else if (command == "socket") {
+        return handleSocket(args);
     }
+    std::cerr << "Unknown command: " << command << std::endl;
+    return false;
 }
 
-void StompClient::handleLogin(const std::vector<std::string>& args) {
-    std::lock_guard<std::mutex> lock(sharedDataMutex); // Protect shared data
+bool StompClient::handleLogin(const std::vector<std::string>& args) {
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait); // Protect shared data
     if (isLoggedIn) {
         std::cout << "Already logged in. Please logout first.\n";
-        return;
+        return false;
     }
     if (args.size() < 4) {
-        std::cout << "Usage: login {host:port} {username} {password}\n";
-        return;
+        std::cout << "Usage: login {host:port|unix:path} {username} {password}\n";
+        return false;
     }
 
     std::string hostport = args[1];
-    std::string host = hostport.substr(0, hostport.find(':'));
-    short port = std::stoi(hostport.substr(hostport.find(':') + 1));
+    std::string host = hostport;
+    short port = 0;
+    if (!ConnectionHandler::isUnixHost(hostport)) {
+        size_t colon = hostport.find(':');
+        host = hostport.substr(0, colon);
+        uint16_t number = 0;
+        if (colon == std::string::npos || !parseNumber(std::string_view(hostport).substr(colon + 1), number) || number == 0) {
+            std::cout << "Invalid port in " << hostport << "\n";
+            return false;
+        }
+        port = static_cast<short>(number);
+    }
     std::string user = args[2];
     std::string pass = args[3];
-    
-    connectionHandler = new ConnectionHandler(host, port);
+
+    // A session that ended on an ERROR frame leaves its objects behind
+    if (serverThread.joinable()) {
+        serverThread.join();
+    }
+    releaseConnections();
+    delete protocol;
+
+    connectionHandler = new ConnectionHandler(host, port, socketOptions);
     protocol = new StompProtocol();
+    protocol->setLazyParsing(lazyReports);
     if (!connectionHandler->connect()) {
         std::cout << "Could not connect to server\n";
         delete connectionHandler;
         connectionHandler = nullptr;
-        return;
-    }
-    std::ostringstream frame;
-    frame << "CONNECT\n"
-          << "accept-version:1.2\n"
-          << "host:stomp.cs.bgu.ac.il\n"
-          << "login:" << user << "\n"
-          << "passcode:" << pass << "\n"
-          << "\n\0";
-        
-    connectionHandler->sendFrameAscii(frame.str(), '\0');
-    if (serverThread.joinable()) {
-            serverThread.join();
+        return false;
     }
-    
+    this->host = host;
+    this->port = port;
     username = user;
+    passcode = pass;
+    connectionHandler->sendFrameAscii(connectFrame(), '\0');
+    sender.start(connectionHandler);
+
     isLoggedIn = true;
-    serverThread = std::thread(&StompClient::serverThreadLoop, this);
+    // The reader starts the heart-beat with what this CONNECT offered, whatever "heartbeat" sets later
+    serverThread = std::thread(&StompClient::serverThreadLoop, this, heartBeatSend, heartBeatReceive);
+    return true;
 }
 
-void StompClient::handleLogout() {
+bool StompClient::handleLogout() {
     {
-        std::lock_guard<std::mutex> lock(sharedDataMutex);
+        auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
         if (!isLoggedIn) {
             std::cout << "Not logged in.\n";
-            return;
+            return false;
         }
         isLoggedIn = false;
-    }
 
-    int receiptId = uniqueIdCounter.fetch_add(1, std::memory_order_relaxed);
+        int receiptId = uniqueIdCounter.fetch_add(1, std::memory_order_relaxed);
 
-    std::ostringstream frame;
-    frame << "DISCONNECT\n"
-          << "receipt:" << receiptId << "\n"
-          << "\n\0";
-    connectionHandler->sendFrameAscii(frame.str(), '\0');
+        std::ostringstream frame;
+        frame << "DISCONNECT\n"
+              << "receipt:" << receiptId << "\n"
+              << "\n\0";
+        sender.send(frame.str(), false);
+        // A reader still reconnecting is waiting on the backoff or on a login that may never answer
+        if (sender.isDown()) {
+            if (connectionAttempt) connectionAttempt->shutdown();
+            connectionHandler->shutdown();
+        }
+        reconnectCondition.notify_all();
+    }
 
     if (serverThread.joinable()) {
         serverThread.join();
     }
     
-    std::lock_guard<std::mutex> lock(sharedDataMutex);
-    delete connectionHandler;
-    connectionHandler = nullptr;
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+    releaseConnections();
     delete protocol;
     protocol = nullptr;
     std::cout << "Logged out.\n";
+    return true;
 }
 
-void StompClient::handleJoin(const std::vector<std::string>& args) {
-    std::lock_guard<std::mutex> lock(sharedDataMutex);
+// Closes the session socket and the standby. The caller holds sharedDataMutex or owns the client alone.
+void StompClient::releaseConnections() {
+    heartBeat.stop();
+    sender.stop();
+    delete connectionHandler;
+    connectionHandler = nullptr;
+    delete standbyConnection;
+    standbyConnection = nullptr;
+}
+
+bool StompClient::handleJoin(const std::vector<std::string>& args) {
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
     if (!isLoggedIn) {
         std::cout << "You must login first.\n";
-        return;
+        return false;
     }
     if (args.size() < 2) {
         std::cout << "Usage: join {channel}\n";
-        return;
+        return false;
     }
     std::string channel = "/"+args[1];
     if(protocol->isSubscribed(channel)){
         std::cout << "Already subscribed to this channel\n";
-        return;
+        return false;
+    }
+    int subId = protocol->joinTopic(channel);
+    if (subId < 0) {
+        std::cout << "Error: Too many subscriptions.\n";
+        return false;
     }
-    int subId = uniqueIdCounter.fetch_add(1, std::memory_order_relaxed);
     int receiptId = uniqueIdCounter.fetch_add(1, std::memory_order_relaxed);
-            channelToSubId[channel] = subId; // Store the subscription ID for the channel
 
     std::ostringstream frame;
     frame << "SUBSCRIBE\n"
@@ -176,30 +317,30 @@ void StompClient::handleJoin(const std::vector<std::string>& args) {
           << "receipt:" << receiptId << "\n"
           << "\n\0";
     
-    connectionHandler->sendFrameAscii(frame.str(), '\0');
-    protocol->joinTopic(channel);
+    sender.send(frame.str(), false); // while reconnecting, the new connection subscribes from the registry
+    lastReceiptId = receiptId;
     std::cout << "Join command processed.\n";
+    return true;
 }
 
-void StompClient::handleExit(const std::vector<std::string>& args) {
-    std::lock_guard<std::mutex> lock(sharedDataMutex); // Protect shared resources
+bool StompClient::handleExit(const std::vector<std::string>& args) {
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait); // Protect shared resources
     if (!isLoggedIn) {
         std::cout << "You must login first.\n";
-        return;
+        return false;
     }
     if (args.size() < 2) {
         std::cout << "Usage: exit {channel}\n";
-        return;
+        return false;
     }
 
 	std::string channel = "/"+args[1];
-	auto it = channelToSubId.find(channel);
-    if (it == channelToSubId.end()) {
+	int subId = protocol->exitTopic(channel);
+    if (subId < 0) {
         std::cout << "Error: Not subscribed to channel \"" << channel << "\".\n";
-        return;
+        return false;
     }
 
-    int subId = it->second;
     int receiptId = uniqueIdCounter.fetch_add(1, std::memory_order_relaxed);
 
     std::ostringstream frame;
@@ -208,69 +349,125 @@ void StompClient::handleExit(const std::vector<std::string>& args) {
           << "receipt:" << receiptId << "\n"
           << "\n\0";
     
-    if(protocol->isSubscribed(channel)){
-        protocol->exitTopic(channel);
-        connectionHandler->sendFrameAscii(frame.str(), '\0');
-        std::cout << "Exit command processed.\n";
-    }
-    else
-    {
-        std::cout << "you are not subscribed to this topic.\n";
-        return;
-    }
+    sender.send(frame.str(), false);
+    lastReceiptId = receiptId;
+    std::cout << "Exit command processed.\n";
+    return true;
 }
 
-void StompClient::handleReport(const std::vector<std::string>& args) {
-    std::lock_guard<std::mutex> lock(sharedDataMutex); // Protect shared resources
+bool StompClient::handleReport(const std::vector<std::string>& args) {
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait); // Protect shared resources
     if (!isLoggedIn) {
         std::cout << "You must login first.\n";
-        return;
+        return false;
     }
     if (args.size() != 2) {
         std::cout << "Usage: report {file.json}\n";
-        return;
+        return false;
     }
 
     std::string filePath = args[1];
-    names_and_events parsedData= parseEventsFile(filePath);
-
-    // Iterate over the events and send them to the server
-   for (size_t i = 0; i < parsedData.events.size(); ++i) {
-    	const Event& event = parsedData.events[i];
-        std::ostringstream body;
-        body << "user:" << username << "\n";
-        body << "city:" << event.get_city() << "\n";
-        body << "event name:" << event.get_name() << "\n";
-        body << "date time:" << event.get_date_time() << "\n";
-        body << "general information:\n";
-        for (const auto& [key, value] : event.get_general_information()) {
-            body << "        "<< key << ":" << value << "\n";
-        }	
-        body << "description:\n" << event.get_description() << "\n";
-		
-        // Construct the STOMP SEND frame
-        std::ostringstream frame;
-        static std::atomic<int> uniqueIdCounter(0);
-		frame << "SEND\n"
-			<< "destination:/" << event.get_channel_name() << "\n"
-			<< "\n"
-			<< body.str() << "\0";
-		
-        // Send the frame
-        connectionHandler->sendFrameAscii(frame.str(), '\0');
+    // A file reported before and not changed since goes out from the cache, unparsed
+    FileStamp stamp;
+    bool cacheable = cacheReports && ReportCache::stamp(filePath, stamp);
+    const EncodedEvents* events = cacheable ? reportCache.find(filePath, stamp) : nullptr;
+    EncodedEvents parsed;
+    if (events == nullptr) {
+        try {
+            ScopedTimer timer(Metrics::EventFileParseTime);
+            parsed = EncodedEvents::encode(parseEventsFile(filePath));
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return false;
+        }
+        if (cacheable) events = reportCache.insert(filePath, stamp, std::move(parsed));
+        if (events == nullptr) events = &parsed;
     }
+
+    if (!sendEvents(*events, lock)) return false;
 	std::cout << "Report command processed.\n";
+    return true;
 }
 
-void StompClient::handleSummary(const std::vector<std::string>& args) {
-    std::lock_guard<std::mutex> lock(sharedDataMutex);
+// Feeds synthetic events straight into the report pipeline, skipping the file and its parsing
+bool StompClient::handleGenerate(const std::vector<std::string>& args) {
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
     if (!isLoggedIn) {
         std::cout << "You must login first.\n";
-        return;
+        return false;
+    }
+    if (args.size() < 3 || args.size() > 4) {
+        std::cout << "Usage: generate {channel} {count} [seed]\n";
+        return false;
+    }
+
+    EventGeneratorOptions options;
+    options.channel = args[1];
+    if (!parseNumber(args[2], options.eventCount) || (args.size() == 4 && !parseNumber(args[3], options.seed))) {
+        std::cout << "Usage: generate {channel} {count} [seed]\n";
+        return false;
+    }
+
+    EventGenerator generator(options);
+    if (!sendEvents(EncodedEvents::encode(generator.generate()), lock)) return false;
+    std::cout << "Generated " << options.eventCount << " reports.\n";
+    return true;
+}
+
+// Sends one SEND frame per encoded body, with this session's user spliced in. The caller holds
+// sharedDataMutex through lock; it is let go while the send queue is full and the connection down,
+// so the reader thread can reconnect. Only the command thread changes events and the login meanwhile.
+bool StompClient::sendEvents(const EncodedEvents& events, std::unique_lock<std::mutex>& lock) {
+    ScopedTimer timer(Metrics::ReportSendTime);
+    std::string body;
+    for (size_t i = 0; i < events.size(); ++i) {
+        std::string_view rest = events.body(i);
+        bool last = i + 1 == events.size();
+
+        // Construct the STOMP SEND frame; the last one asks for a receipt so callers can wait for delivery
+        std::string frame;
+        frame.reserve(64 + events.destination.size() + username.size() + rest.size());
+        frame.append("SEND\ndestination:").append(events.destination).append("\n");
+        if (last) {
+            lastReceiptId = uniqueIdCounter.fetch_add(1, std::memory_order_relaxed);
+            frame.append("receipt:").append(std::to_string(lastReceiptId)).append("\n");
+        }
+        if (compressBodies) {
+            body.assign("user:").append(username).append(rest);
+            size_t headerEnd = frame.size();
+            frame.append("content-encoding:").append(BODY_CONTENT_ENCODING).append("\n\n");
+            if (!bodyCompressor.compress(body, frame)) {
+                frame.resize(headerEnd); // too small to gain anything
+                frame.append("\n").append(body);
+            }
+        } else {
+            frame.append("\nuser:").append(username).append(rest);
+        }
+
+        // Queue the frame; the sender reports when the last one is on the wire
+        std::string note = last ? "Report sent: " + std::to_string(events.size()) + " events." : "";
+        while (!sender.send(std::move(frame), true, std::move(note))) {
+            lock.unlock();
+            bool connected = sender.waitForConnection();
+            lock.lock();
+            if (!connected || !isLoggedIn) {
+                std::cerr << "Error: Could not send report to server\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool StompClient::handleSummary(const std::vector<std::string>& args) {
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+    if (!isLoggedIn) {
+        std::cout << "You must login first.\n";
+        return false;
     }
     if (args.size() < 4) {
         std::cout << "Usage: summary {channel_name} {user} {file}\n";
-        return;
+        return false;
     }
 
     std::string channel = "/"+args[1];
@@ -281,17 +478,383 @@ void StompClient::handleSummary(const std::vector<std::string>& args) {
     auto reports = protocol->getReports(channel, user);
     if (reports.empty()) {
         std::cout << "No reports found for channel \"" << channel << "\" and user \"" << user << "\".\n";
-        return;
+        return false;
+    }
+
+    if (!writeSummary(channel, std::move(reports), outputFilePath)) {
+        std::cerr << "Error: Could not create file " << outputFilePath << "\n";
+        return false;
+    }
+    std::cout << "Summary written to " << outputFilePath << "\n";
+    return true;
+}
+
+bool StompClient::handleSummaryAll(const std::vector<std::string>& args) {
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+    if (!isLoggedIn) {
+        std::cout << "You must login first.\n";
+        return false;
+    }
+    if (args.size() < 2) {
+        std::cout << "Usage: summary-all {file_prefix}\n";
+        return false;
+    }
+
+    std::vector<std::pair<std::string, std::string>> pairs = protocol->getReportKeys();
+    if (pairs.empty()) {
+        std::cout << "No reports found.\n";
+        return false;
     }
 
+    // Each (channel, user) pair is fetched, sorted and written independently,
+    // so the pairs are spread over one worker per core.
+    std::vector<std::string> outputPaths(pairs.size());
+    std::vector<char> written(pairs.size(), 0);
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < pairs.size(); i = next.fetch_add(1)) {
+            const std::string& channel = pairs[i].first;
+            const std::string& user = pairs[i].second;
+            outputPaths[i] = "../client/bin/" + args[1] + "_" + channel.substr(1) + "_" + user + ".txt";
+            written[i] = writeSummary(channel, protocol->getReports(channel, user), outputPaths[i]);
+        }
+    };
+
+    size_t workerCount = std::max(1u, std::thread::hardware_concurrency());
+    workerCount = std::min(workerCount, pairs.size());
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < workerCount; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    bool allWritten = true;
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        if (written[i]) {
+            std::cout << "Summary written to " << outputPaths[i] << "\n";
+        } else {
+            std::cerr << "Error: Could not create file " << outputPaths[i] << "\n";
+            allWritten = false;
+        }
+    }
+    return allWritten;
+}
+
+bool StompClient::handleQuery(const std::vector<std::string>& args) {
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+    if (!isLoggedIn) {
+        std::cout << "You must login first.\n";
+        return false;
+    }
+    if (args.size() < 2) {
+        std::cout << "Usage: query {channel} [user=..] [city=..] [event=..] [from=..] [to=..] [{key}=={value}]...\n";
+        return false;
+    }
+
+    std::string channel = "/" + args[1];
+    ReportQuery query;
+    for (size_t i = 2; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        size_t detailPos = arg.find("==");
+        if (detailPos != std::string::npos) {
+            // Typed like a report body value, so active==true matches the boolean and units==3 the integer
+            query.details[arg.substr(0, detailPos)] = DetailValue::parse(std::string_view(arg).substr(detailPos + 2));
+            continue;
+        }
+        size_t equalPos = arg.find('=');
+        if (equalPos == std::string::npos) {
+            std::cout << "Invalid filter \"" << arg << "\"\n";
+            return false;
+        }
+        std::string field = arg.substr(0, equalPos);
+        std::string value = arg.substr(equalPos + 1);
+        if (field == "user") {
+            query.user = value;
+        } else if (field == "city") {
+            query.city = value;
+        } else if (field == "event") {
+            query.eventName = value;
+        } else if (field == "from" || field == "to") {
+            long time;
+            if (!parseTimeArg(value, field == "to", time)) {
+                std::cout << "Invalid time \"" << value << "\", expected epoch seconds, dd/mm/yyyy or dd/mm/yyyy_HH:MM:SS\n";
+                return false;
+            }
+            (field == "from" ? query.from : query.to) = time;
+        } else {
+            std::cout << "Unknown filter \"" << field << "\"\n";
+            return false;
+        }
+    }
+
+    std::vector<Report> reports = protocol->queryReports(channel, query);
+    std::cout << reports.size() << " matching reports on channel " << args[1] << "\n";
+    for (const auto& report : reports) {
+        std::cout << epochToDateTime(report.dateTime) << " | " << report.user << " | "
+                  << report.city << " | " << report.eventName << "\n";
+    }
+    return true;
+}
+
+bool StompClient::handleRetention(const std::vector<std::string>& args) {
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+    if (!isLoggedIn) {
+        std::cout << "You must login first.\n";
+        return false;
+    }
+    if (args.size() < 2) {
+        std::cout << "Usage: retention {channel|*} [reports=N] [age=SECONDS] [bytes=N]\n";
+        return false;
+    }
+
+    RetentionPolicy policy;
+    for (size_t i = 2; i < args.size(); ++i) {
+        size_t equalPos = args[i].find('=');
+        std::string field = args[i].substr(0, equalPos);
+        unsigned long limit = 0;
+        if (equalPos == std::string::npos || !parseNumber(std::string_view(args[i]).substr(equalPos + 1), limit)) {
+            std::cout << "Invalid limit \"" << args[i] << "\"\n";
+            return false;
+        }
+        if (field == "reports") {
+            policy.maxReports = limit;
+        } else if (field == "age") {
+            policy.maxAgeSeconds = limit;
+        } else if (field == "bytes") {
+            policy.maxBytes = limit;
+        } else {
+            std::cout << "Unknown limit \"" << field << "\"\n";
+            return false;
+        }
+    }
+
+    protocol->setRetention(args[1] == "*" ? "" : "/" + args[1], policy);
+    std::cout << "Retention updated.\n";
+    return true;
+}
+
+bool StompClient::handleMemory() {
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+    if (!isLoggedIn) {
+        std::cout << "You must login first.\n";
+        return false;
+    }
+
+    size_t totalReports = 0;
+    size_t totalBytes = 0;
+    for (const auto& [topic, usage] : protocol->getMemoryUsage()) {
+        std::cout << topic.substr(1) << ": " << usage.reports << " reports, " << usage.bytes
+                  << " bytes, " << usage.evicted << " evicted\n";
+        totalReports += usage.reports;
+        totalBytes += usage.bytes;
+    }
+    std::cout << "Total: " << totalReports << " reports, " << totalBytes << " bytes\n";
+    return true;
+}
+
+bool StompClient::handleStats(const std::vector<std::string>& args) {
+    if (args.size() == 1) {
+        std::cout << Metrics::format(Metrics::snapshot());
+        return true;
+    }
+    if (args.size() == 3 && args[1] == "dump" && args[2] == "off") {
+        stopStatsDump();
+        std::cout << "Stats dump stopped.\n";
+        return true;
+    }
+    int interval = 0;
+    if (args.size() == 4 && args[1] == "dump") parseNumber(args[3], interval);
+    if (interval <= 0) {
+        std::cout << "Usage: stats | stats dump {file} {seconds} | stats dump off\n";
+        return false;
+    }
+
+    stopStatsDump();
+    std::string outputFilePath = "../client/bin/" + args[2];
+    statsRunning = true;
+    statsThread = std::thread([this, outputFilePath, interval]() {
+        std::unique_lock<std::mutex> lock(statsMutex);
+        while (!statsCondition.wait_for(lock, std::chrono::seconds(interval), [this]() { return !statsRunning; })) {
+            std::ofstream ofs(outputFilePath, std::ios::app);
+            ofs << "--- " << epochToDateTime(std::time(nullptr)) << "\n" << Metrics::format(Metrics::snapshot());
+        }
+    });
+    std::cout << "Dumping stats to " << outputFilePath << " every " << interval << " seconds.\n";
+    return true;
+}
+
+bool StompClient::handleTrace(const std::vector<std::string>& args) {
+    if (args.size() == 2 && args[1] == "start") {
+        Trace::start();
+        std::cout << "Tracing started.\n";
+        return true;
+    }
+    if (args.size() == 3 && args[1] == "stop") {
+        std::string outputFilePath = "../client/bin/" + args[2];
+        if (!Trace::stop(outputFilePath)) {
+            std::cerr << "Error: Could not create file " << outputFilePath << "\n";
+            return false;
+        }
+        std::cout << "Trace written to " << outputFilePath << "\n";
+        return true;
+    }
+    std::cout << "Usage: trace start | trace stop {file}\n";
+    return false;
+}
+
+bool StompClient::handleCompress(const std::vector<std::string>& args) {
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+    if (args.size() != 2 || (args[1] != "on" && args[1] != "off")) {
+        std::cout << "Usage: compress {on|off}\n";
+        return false;
+    }
+    if (args[1] == "on" && !SERVER_FORWARDS_CONTENT_ENCODING) {
+        std::cout << "Report body compression needs a server that forwards content-encoding; the bundled one does not.\n";
+        return false;
+    }
+    compressBodies = args[1] == "on";
+    std::cout << "Report body compression " << (compressBodies ? "enabled" : "disabled") << ".\n";
+    return true;
+}
+
+bool StompClient::handleLazy(const std::vector<std::string>& args) {
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+    if (args.size() != 2 || (args[1] != "on" && args[1] != "off")) {
+        std::cout << "Usage: lazy {on|off}\n";
+        return false;
+    }
+    lazyReports = args[1] == "on";
+    if (protocol != nullptr) protocol->setLazyParsing(lazyReports);
+    std::cout << "Lazy report parsing " << (lazyReports ? "enabled" : "disabled") << ".\n";
+    return true;
+}
+
+bool StompClient::handleCache(const std::vector<std::string>& args) {
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+    if (args.size() == 1) {
+        const std::string& directory = reportCache.getDirectory();
+        std::cout << "Report cache " << (cacheReports ? "on" : "off") << ": " << reportCache.entries() << " files, "
+                  << reportCache.bytes() << " bytes, " << reportCache.hits() << " hits, " << reportCache.misses()
+                  << " misses, directory " << (directory.empty() ? "none" : directory) << "\n";
+        return true;
+    }
+    if (args.size() == 2 && (args[1] == "on" || args[1] == "off")) {
+        cacheReports = args[1] == "on";
+        if (!cacheReports) reportCache.clear();
+        std::cout << "Report cache " << (cacheReports ? "enabled" : "disabled") << ".\n";
+        return true;
+    }
+    if (args.size() == 2 && args[1] == "clear") {
+        reportCache.clear();
+        std::cout << "Report cache cleared.\n";
+        return true;
+    }
+    if (args.size() == 3 && args[1] == "dir") {
+        std::string directory = args[2] == "off" ? "" : args[2];
+        if (!reportCache.setDirectory(directory)) {
+            std::cout << "Cannot use \"" << directory << "\" as the report cache directory.\n";
+            return false;
+        }
+        std::cout << "Report cache " << (directory.empty() ? "kept in memory only" : "also kept in " + directory) << ".\n";
+        return true;
+    }
+    std::cout << "Usage: cache [on|off|clear] | cache dir {directory|off}\n";
+    return false;
+}
+
+bool StompClient::handleHeartBeat(const std::vector<std::string>& args) {
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+    long send = -1;
+    long receive = -1;
+    if (args.size() != 3 || !parseNumber(args[1], send) || !parseNumber(args[2], receive) || send < 0 || receive < 0) {
+        std::cout << "Usage: heartbeat {send_ms} {receive_ms} (0 disables)\n";
+        return false;
+    }
+    heartBeatSend = std::chrono::milliseconds(send);
+    heartBeatReceive = std::chrono::milliseconds(receive);
+    std::cout << "Heart-beat offer set to " << send << "," << receive << " ms for the next login.\n";
+    return true;
+}
+
+bool StompClient::handleSocket(const std::vector<std::string>& args) {
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+    if (args.size() == 1) {
+        std::cout << "nodelay " << (socketOptions.noDelay ? "on" : "off")
+                  << ", quickack " << (socketOptions.quickAck ? "on" : "off")
+                  << ", sndbuf " << socketOptions.sendBuffer << ", rcvbuf " << socketOptions.receiveBuffer
+                  << ", busypoll " << socketOptions.busyPollMicros << " (0 is the OS default)"
+                  << ", uring " << (socketOptions.ioUring ? "on" : "off") << "\n";
+        return true;
+    }
+    std::string option = args.size() == 3 ? args[1] : "";
+    std::string value = args.size() == 3 ? args[2] : "";
+    int number = -1;
+    parseNumber(value, number);
+    bool valid = true;
+    if (option == "nodelay" && (value == "on" || value == "off")) {
+        socketOptions.noDelay = value == "on";
+    } else if (option == "quickack" && (value == "on" || value == "off")) {
+        socketOptions.quickAck = value == "on";
+    } else if (option == "uring" && (value == "on" || value == "off")) {
+        socketOptions.ioUring = value == "on";
+    } else if (option == "sndbuf" && number >= 0) {
+        socketOptions.sendBuffer = number;
+    } else if (option == "rcvbuf" && number >= 0) {
+        socketOptions.receiveBuffer = number;
+    } else if (option == "busypoll" && number >= 0) {
+        socketOptions.busyPollMicros = number;
+    } else {
+        valid = false;
+    }
+    if (!valid) {
+        std::cout << "Usage: socket [{nodelay|quickack|uring} {on|off}] [{sndbuf|rcvbuf} {bytes}] [busypoll {usec}]\n";
+        return false;
+    }
+    std::cout << "Socket option " << option << " set to " << value << " for new connections.\n";
+    return true;
+}
+
+void StompClient::stopStatsDump() {
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        statsRunning = false;
+    }
+    statsCondition.notify_all();
+    if (statsThread.joinable()) {
+        statsThread.join();
+    }
+}
+
+// Accepts epoch seconds, "dd/mm/yyyy" or "dd/mm/yyyy_HH:MM:SS" in local time.
+// A bare date used as an upper bound covers the whole day.
+bool StompClient::parseTimeArg(const std::string& value, bool endOfDay, long& time) {
+    if (value.find('/') == std::string::npos) return parseNumber(value, time);
+
+    std::tm tm{};
+    std::istringstream iss(value);
+    bool hasTime = value.find('_') != std::string::npos;
+    iss >> std::get_time(&tm, hasTime ? "%d/%m/%Y_%H:%M:%S" : "%d/%m/%Y");
+    if (iss.fail()) return false;
+    tm.tm_isdst = -1;
+    time = std::mktime(&tm);
+    if (!hasTime && endOfDay) time += 24 * 60 * 60 - 1;
+    return true;
+}
+
+bool StompClient::writeSummary(const std::string& channel, std::vector<Report> reports, const std::string& outputFilePath) {
+    TraceSpan span("summary write");
     // Calculate statistics
     int total = reports.size();
     int active = std::count_if(reports.begin(), reports.end(), [](const Report& report) {
-        return report.details.find("active") != report.details.end() && report.details.at("active") == "true";
+        auto it = report.details.find("active");
+        return it != report.details.end() && it->second.isTrue();
     });
     int forcesArrival = std::count_if(reports.begin(), reports.end(), [](const Report& report) {
-        return report.details.find("forces_arrival_at_scene") != report.details.end() &&
-               report.details.at("forces_arrival_at_scene") == "true";
+        auto it = report.details.find("forces_arrival_at_scene");
+        return it != report.details.end() && it->second.isTrue();
     });
 
     // Sort events by date
@@ -302,8 +865,7 @@ void StompClient::handleSummary(const std::vector<std::string>& args) {
     // Write to file
     std::ofstream ofs(outputFilePath);
     if (!ofs) {
-        std::cerr << "Error: Could not create file " << outputFilePath << "\n";
-        return;
+        return false;
     }
 
     ofs << "Channel " << channel.substr(1) << "\n";
@@ -318,7 +880,11 @@ void StompClient::handleSummary(const std::vector<std::string>& args) {
         reportCounter++;
         ofs << "Report_" << reportCounter << ":\n";
         ofs << "city: " << report.city << "\n";
-        ofs << "date time: " << epochToDateTime(report.dateTime) << "\n";
+        char dateTime[DateFormatter::LENGTH];
+        dateFormatter.format(report.dateTime, dateTime);
+        ofs << "date time: ";
+        ofs.write(dateTime, DateFormatter::LENGTH);
+        ofs << "\n";
         ofs << "event name: " << report.eventName << "\n";
 
         // Trim the description for summary
@@ -330,72 +896,216 @@ void StompClient::handleSummary(const std::vector<std::string>& args) {
     }
 
     ofs.close();
-    std::cout << "Summary written to " << outputFilePath << "\n";
+    return true;
 }
 
 std::string StompClient::epochToDateTime(long epochTime) {
-    std::time_t time = epochTime;
-    std::tm* tmPtr = std::localtime(&time);
-    std::ostringstream oss;
-    oss << std::put_time(tmPtr, "%d/%m/%Y %H:%M:%S");
-    return oss.str();
+    return dateFormatter.format(epochTime);
 }
 
-void StompClient::serverThreadLoop() {
+// Value of header name in frame, empty if it has none
+static std::string frameHeader(std::string_view frame, std::string_view name) {
+    size_t end = frame.find('\n'); // end of the command line
+    while (end != std::string_view::npos) {
+        size_t start = end + 1;
+        end = frame.find('\n', start);
+        std::string_view line = frame.substr(start, end == std::string_view::npos ? end : end - start);
+        if (line.empty()) break;
+        if (line.size() > name.size() && line[name.size()] == ':' && line.substr(0, name.size()) == name) {
+            return std::string(line.substr(name.size() + 1));
+        }
+    }
+    return "";
+}
+
+void StompClient::serverThreadLoop(std::chrono::milliseconds send, std::chrono::milliseconds receive) {
+    Trace::setThreadName("reader");
+    openStandby();
+    std::vector<std::string> frames; // one batch for the protocol
     while (true) {
-            std::string frameBuffer;
             std::string line;
+            // After an ERROR frame the connection and protocol are released by the next login
             if(!protocol->isLoggedIn()){
                 isLoggedIn=false;
-                delete connectionHandler;
-                connectionHandler = nullptr;
-                delete protocol;
-                protocol = nullptr;
             }
             if (!isLoggedIn)break;
             bool success = connectionHandler->getLine(line);
             if (!success) {
-                std::cerr << "Disconnected from server.\n";
-                break;
-            }
-        std::istringstream iss(line);
-        // Parse the command (first line)
-        getline(iss, line);
-        std::string command = line;
-
-        // Parse headers
-        std::unordered_map<std::string, std::string> headers;
-        while (getline(iss, line) && !line.empty()) {
-            size_t delimiterPos = line.find(":");
-            if (delimiterPos != std::string::npos) {
-                std::string key = line.substr(0, delimiterPos);
-                std::string value = line.substr(delimiterPos + 1);
-                headers[key] = value;
+                if (!isLoggedIn) break; // logged out
+                std::cerr << "Disconnected from server, reconnecting.\n";
+                if (!reconnect()) break;
+                continue;
             }
+        // Besides the frame waited for, take every frame that came in with it, so a burst of
+        // MESSAGE frames is stored under one lock
+        frames.clear();
+        bool connectedFrame = false;
+        std::string heartBeatHeader;
+        while (true) {
+        TraceSpan span("frame extraction");
+        // The protocol parses the frame itself; only the heart-beat header of CONNECTED is needed here
+        connectedFrame = std::string_view(line).substr(0, line.find('\n')) == "CONNECTED";
+        if (connectedFrame) heartBeatHeader = frameHeader(line, "heart-beat");
+        frames.push_back(std::move(line));
+
+        // CONNECTED ends a batch: the heart-beat starts right after it is processed
+        if (connectedFrame || frames.size() >= MAX_RECEIVE_BATCH || !connectionHandler->hasBufferedFrame('\0')) break;
+        line.clear();
+        connectionHandler->getLine(line); // already received, so it cannot fail
+        }
+            protocol->processFrames(frames); // Process the full frames
+            if (connectedFrame) heartBeat.start(connectionHandler, sender, send, receive, heartBeatHeader);
         }
+        // No reconnect comes after this; a report waiting for one gives up once the queue is written
+        sender.stop();
+        //std::cout << "Exiting server thread loop.\n";
+}
+
+// The caller holds sharedDataMutex, which guards the login and heart-beat settings
+std::string StompClient::connectFrame() const {
+    std::ostringstream frame;
+    frame << "CONNECT\n"
+          << "accept-version:1.2\n"
+          << "host:stomp.cs.bgu.ac.il\n"
+          << "login:" << username << "\n"
+          << "passcode:" << passcode << "\n"
+          << HeartBeat::offer(heartBeatSend, heartBeatReceive)
+          << "\n";
+    return frame.str();
+}
+
+// An unconnected handler for the session's server with the current socket options. The caller
+// holds sharedDataMutex, which guards them against "socket" and login; it connects after letting go.
+ConnectionHandler* StompClient::newConnection() const {
+    return new ConnectionHandler(host, port, socketOptions);
+}
+
+// Opens the standby connection unless there already is one. Called by the reader thread.
+void StompClient::openStandby() {
+    ConnectionHandler* standby;
+    {
+        auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+        if (standbyConnection != nullptr || !isLoggedIn) return;
+        standby = newConnection();
+    }
+    if (!standby->connect(false)) {
+        delete standby;
+        return;
+    }
+    auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+    if (standbyConnection == nullptr && isLoggedIn) {
+        standbyConnection = standby;
+    } else {
+        delete standby;
+    }
+}
 
-        // Parse the body (remaining lines)
-        std::string body;
-        getline(iss, body, '\0'); // Read until the null character (or end of stream)
-        std::ostringstream oss;
+// Called by the reader thread when the session connection fails. Takes over the standby
+// connection if there is one, or connects again with exponential backoff, logs in, re-subscribes
+// to every joined topic with its old subscription id and sends the frames held meanwhile.
+// Returns false if the user logged out before that succeeded, or if the server answered the
+// login with an ERROR frame, which ends the session.
+bool StompClient::reconnect() {
+    TraceSpan span("reconnect");
+    heartBeat.stop();
+    sender.connectionLost();
 
-        // Add the command
-        oss << command << "\n";
+    std::chrono::milliseconds delay = RECONNECT_INITIAL_DELAY;
+    while (true) {
+        ConnectionHandler* next;
+        ConnectionHandler* fresh = nullptr; // connected to if there is no standby
+        bool standby;
+        // The command thread may change the heart-beat settings meanwhile; the timers run with what this CONNECT offers
+        std::string login;
+        std::chrono::milliseconds send;
+        std::chrono::milliseconds receive;
+        {
+            auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+            if (!isLoggedIn) return false;
+            login = connectFrame();
+            send = heartBeatSend;
+            receive = heartBeatReceive;
+            next = standbyConnection;
+            standby = next != nullptr;
+            standbyConnection = nullptr;
+            connectionAttempt = next;
+            if (!standby) fresh = newConnection();
+        }
+        if (next == nullptr) {
+            next = fresh;
+            if (!next->connect(false)) {
+                delete next;
+                next = nullptr;
+            }
+            auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+            connectionAttempt = next;
+            if (!isLoggedIn) {
+                delete next;
+                connectionAttempt = nullptr;
+                return false;
+            }
+        }
 
-        // Add each header
-        for (const auto& header : headers) {
-            oss << header.first << ":" << header.second << "\n";
+        std::string reply;
+        bool replied = next != nullptr && next->sendFrameAscii(login, '\0') && next->getLine(reply);
+        if (replied && reply.compare(0, 5, "ERROR") == 0) {
+            // Refused, say for the credentials; every further attempt would be refused the same way
+            protocol->processFrame(reply);
+            std::cout << "The server refused to log in again; logged out.\n";
+            auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+            connectionAttempt = nullptr;
+            delete next;
+            isLoggedIn = false;
+            return false;
         }
+        if (replied && reply.compare(0, 9, "CONNECTED") == 0) {
+            protocol->processFrame(reply);
 
-        // Add an empty line to separate headers and body
-        oss << "\n";
+            auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+            connectionAttempt = nullptr;
+            if (!isLoggedIn) {
+                delete next;
+                return false;
+            }
+            // Subscriptions first, then the sender resumes with the frames it held
+            bool sent = true;
+            for (const auto& [topic, subId] : protocol->getSubscriptions()) {
+                std::ostringstream frame;
+                frame << "SUBSCRIBE\n"
+                      << "destination:" << topic << "\n"
+                      << "id:" << subId << "\n"
+                      << "\n";
+                sent = sent && next->sendFrameAscii(frame.str(), '\0');
+            }
+            if (sent) {
+                sender.setConnection(next);
+                delete connectionHandler;
+                connectionHandler = next;
+                heartBeat.start(next, sender, send, receive, frameHeader(reply, "heart-beat"));
+                Metrics::increment(Metrics::Reconnects);
+                std::cout << "Reconnected to server.\n";
+                break;
+            }
+            // Lost again already; back off like any failed attempt
+            delete next;
+            next = nullptr;
+            standby = false;
+        }
 
-        // Add the body
-        oss << body;
-            protocol->processFrame(oss.str()); // Process the full frame
-            frameBuffer.clear(); // Clear buffer for the next frame
+        {
+            auto lock = Metrics::timedLock(sharedDataMutex, Metrics::SharedDataLockWait);
+            connectionAttempt = nullptr;
+            delete next;
+            // A dead standby usually went down with the session; try a fresh connection right away
+            if (standby) continue;
+            reconnectCondition.wait_for(lock, delay, [this] { return !isLoggedIn; });
+            if (!isLoggedIn) return false;
         }
-        //std::cout << "Exiting server thread loop.\n";
+        delay = std::min(delay * 2, RECONNECT_MAX_DELAY);
+    }
+
+    openStandby();
+    return true;
 }
 
 
@@ -1,13 +1,19 @@
 #include <sstream>
 #include <iostream>
+#include <ctime>
+#include <optional>
 #include "StompProtocol.h"
 #include "StompClient.h"
 #include "event.h"
-#include <json.hpp>
-using json = nlohmann::json;
+#include "Metrics.h"
+#include "ReportCodec.h"
+#include "ParseNumber.h"
 
 StompProtocol::StompProtocol()
-    : protocolMutex(), reportStorage(),joinedTopics() {}
+    : protocolMutex(), reportStorage(), retentionPolicies(), defaultRetention(), loggedIn(true),
+      connected(false), receivedReceipts(), stateChanged(), subscriptions(),
+      bodyDecompressor(), inflatedBody(), lazyParsing(false), pendingReports(), pendingDecoded(), pendingText(), reportBatch(),
+      rawBatch() {}
 
 std::string StompProtocol::createFrame(const std::string& command, const std::map<std::string, std::string>& headers, const std::string& body) {
     std::ostringstream frame;
@@ -21,186 +27,279 @@ std::string StompProtocol::createFrame(const std::string& command, const std::ma
     return frame.str();
 }
 
-std::map<std::string, std::string> parseHeaders(const std::string& frame) {
-    std::istringstream stream(frame);
-    std::map<std::string, std::string> headers;
-    std::string line;
-
-    // Skip command line
-    std::getline(stream, line);
+void StompProtocol::processFrame(const std::string& frame) {
+    handleFrame(frame);
+    applyReports();
+}
 
-    // Parse headers
-    while (std::getline(stream, line) && !line.empty()) {
-        auto separator = line.find(':');
-        if (separator != std::string::npos) {
-            std::string key = line.substr(0, separator);
-            std::string value = line.substr(separator + 1);
-            headers[key] = value;
-        }
+void StompProtocol::processFrames(const std::vector<std::string>& frames) {
+    for (const std::string& frame : frames) {
+        handleFrame(frame);
     }
-
-    return headers;
+    applyReports();
 }
 
-void StompProtocol::processFrame(const std::string& frame) {
-    std::istringstream stream(frame);
-    std::string command;
+void StompProtocol::handleFrame(const std::string& frame) {
+    uint64_t parseStart = Metrics::now();
+    std::string_view rest(frame);
+    // Takes the next line off rest, without its '\n'
+    auto nextLine = [&rest]() {
+        size_t end = rest.find('\n');
+        std::string_view line = rest.substr(0, end);
+        rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+        return line;
+    };
 
-    if (!std::getline(stream, command)) {
+    if (rest.empty()) {
         std::cerr << "Error: Unable to parse command from frame." << std::endl;
         return;
     }
-    
-    std::map<std::string, std::string> headers;
-    std::string line;
+    std::string_view command = nextLine();
 
-    // Parse headers
-    while (std::getline(stream, line) && !line.empty()) {
+    // Only the headers some command below reads, as views into frame; a repeated header keeps its last value
+    std::optional<std::string_view> destination, subscription, encoding, receiptId, message;
+    while (!rest.empty()) {
+        std::string_view line = nextLine();
+        if (line.empty()) break;
         size_t separator = line.find(':');
-        if (separator != std::string::npos) {
-            std::string key = line.substr(0, separator);
-            std::string value = line.substr(separator + 1);
-            headers[key] = value;
-        } else {
+        if (separator == std::string_view::npos) {
             std::cerr << "Invalid header format: " << line << std::endl;
+            continue;
         }
+        std::string_view key = line.substr(0, separator);
+        std::string_view value = line.substr(separator + 1);
+        if (key == "destination") destination = value;
+        else if (key == "subscription") subscription = value;
+        else if (key == "content-encoding") encoding = value;
+        else if (key == "receipt-id") receiptId = value;
+        else if (key == "message") message = value;
     }
 
-    // Parse body
-    std::string body;
-    if (stream.peek() != EOF) {
-        std::getline(stream, body, '\0');
-    }
+    // The body runs to the end of the frame or its '\0'
+    std::string_view body = rest.substr(0, rest.find('\0'));
+    uint64_t parseEnd = Metrics::now();
+    Metrics::record(Metrics::ParseTime, parseEnd - parseStart);
+    if (Trace::enabled()) Trace::record("parse", parseStart, parseEnd);
+
+    // Reports already received are stored before anything a later frame makes visible, like a RECEIPT
+    if (command != "MESSAGE") applyReports();
 
     // Handle commands
     if (command == "CONNECTED") {
         std::cout << "Successfully connected to server." << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(protocolMutex);
+            connected = true;
+        }
         setLoggedIn(true); // Mark as logged in
     } else if (command == "MESSAGE") {
-        // Get topic from the header
-        auto destinationIt = headers.find("destination");
-        if (destinationIt == headers.end()) {
+        if (!destination) {
             std::cerr << "MESSAGE frame missing 'destination' header." << std::endl;
             return;
         }
-        std::string topic = destinationIt->second;
-
-        // Extract user from the body
-        auto userPos = body.find("user:");
-        if (userPos == std::string::npos) {
-            std::cerr << "MESSAGE frame body missing 'user' field." << std::endl;
-            return;
+        std::string_view subscriptionId = subscription.value_or(std::string_view());
+        if (!encoding) {
+            queueReport(subscriptionId, *destination, body);
+        } else if (*encoding == BODY_CONTENT_ENCODING && bodyDecompressor.decompress(body, inflatedBody)) {
+            queueReport(subscriptionId, *destination, inflatedBody);
+        } else {
+            std::cerr << "Cannot decode MESSAGE body with content-encoding: " << *encoding << std::endl;
         }
-        // Extract the value after "user:"
-        auto userStart = userPos + 5; // Move past "user:"
-        auto userEnd = body.find('\n', userStart);
-        std::string user = body.substr(userStart, userEnd - userStart);
-
-        // Trim leading/trailing spaces
-        user.erase(0, user.find_first_not_of(" \t"));
-        user.erase(user.find_last_not_of(" \t") + 1);
-
-        // Store the report
-        storeReport(topic, user, body);
-        //std::cout << "Stored MESSAGE for topic: " << topic << ", user: " << user << std::endl;
     } else if (command == "RECEIPT") {
-        // auto it = headers.find("receipt-id");
-        // if (it != headers.end()) {
-        //     std::cout << "Received receipt with ID: " << it->second << std::endl;
-        // } else {
-        //     std::cerr << "Receipt frame missing receipt-id header." << std::endl;
-        // }
+        if (!receiptId) {
+            std::cerr << "Receipt frame missing receipt-id header." << std::endl;
+            return;
+        }
+        int id = 0;
+        if (!parseNumber(*receiptId, id)) {
+            std::cerr << "Invalid receipt-id: " << *receiptId << std::endl;
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(protocolMutex);
+            receivedReceipts.insert(id);
+        }
+        stateChanged.notify_all();
     } else if (command == "ERROR") {
         setLoggedIn(false);
         std::cerr << "Received ERROR frame." << std::endl;
-        auto it = headers.find("message");
-        if (it != headers.end()) {
-            std::cerr << "Error message: " << it->second << std::endl;
+        if (message) {
+            std::cerr << "Error message: " << *message << std::endl;
         }
     } else {
         std::cerr << "Unknown command: " << command << std::endl;
     }
 }
 
-void StompProtocol::storeReport(const std::string& topic, const std::string& user, const std::string& content) {
-    std::lock_guard<std::mutex> lock(protocolMutex);
-    std::string key = topic + ":" + user;
+ReportStore& StompProtocol::storeFor(std::string_view topic) {
+    auto it = reportStorage.find(topic);
+    if (it == reportStorage.end()) {
+        auto policy = retentionPolicies.find(topic);
+        it = reportStorage.emplace(std::string(topic), ReportStore()).first;
+        it->second.setRetention(policy == retentionPolicies.end() ? defaultRetention : policy->second, std::time(nullptr));
+    }
+    return it->second;
+}
+
+void StompProtocol::queueReport(std::string_view subscription, std::string_view topic, std::string_view body) {
+    TraceSpan span("decode");
+    PendingReport pending;
+    pending.raw = lazyParsing.load(std::memory_order_relaxed);
+    bool valid;
+    if (pending.raw) {
+        valid = ReportCodec::scan(body, pending.header);
+    } else {
+        pending.report = pendingDecoded.size();
+        valid = ReportCodec::decode(body, pendingDecoded.emplace_back());
+        if (!valid) pendingDecoded.pop_back();
+    }
+    if (!valid) {
+        std::cerr << "Error while storing report: missing user or invalid date time\n";
+        return;
+    }
+    pending.subscribed = parseNumber(subscription, pending.subscription);
+    // A burst of MESSAGE frames usually shares its destination; copy it once
+    const PendingReport* previous = pendingReports.empty() ? nullptr : &pendingReports.back();
+    if (previous != nullptr && std::string_view(pendingText).substr(previous->topicOffset, previous->topicLength) == topic) {
+        pending.topicOffset = previous->topicOffset;
+    } else {
+        pending.topicOffset = pendingText.size();
+        pendingText.append(topic);
+    }
+    pending.topicLength = topic.size();
+    if (pending.raw) {
+        pending.bodyOffset = pendingText.size();
+        pending.bodyLength = body.size();
+        pendingText.append(body);
+    }
+    pendingReports.push_back(pending);
+}
 
-    Report report;
+void StompProtocol::applyReports() {
+    if (pendingReports.empty()) return;
+    ScopedTimer timer(Metrics::StoreTime);
+    TraceSpan span("store");
 
+    auto lock = Metrics::timedLock(protocolMutex, Metrics::ProtocolLockWait);
+    long now = std::time(nullptr);
     try {
-        std::istringstream stream(content);
-        std::string line;
-        std::string currentSection;
-
-        while (std::getline(stream, line)) {
-            // Trim whitespace
-            line.erase(0, line.find_first_not_of(" \t"));
-            line.erase(line.find_last_not_of(" \t") + 1);
-
-            if (line.empty()) continue; // Skip empty lines
-
-            size_t colonPos = line.find(':');
-            if (colonPos != std::string::npos) {
-                std::string field = line.substr(0, colonPos);
-                std::string value = line.substr(colonPos + 1);
-                value.erase(0, value.find_first_not_of(" \t")); // Trim leading spaces
-
-                // Map fields to the `Report` structure
-                if (field == "user") {
-                    // Ignore the user field (already captured)
-                } else if (field == "city") {
-                    report.city = value;
-                } else if (field == "event name") {
-                    report.eventName = value;
-                } else if (field == "date time") {
-                    report.dateTime = std::stol(value);
-                } else if (field == "description") {
-                    currentSection = "description";
-                    report.description = value;
-                } else if (field == "general information") {
-                    currentSection = "general_information";
-                } else if (currentSection == "general_information") {
-                    // Handle details under "general information"
-                    report.details[field] = value;
-                }
-            } else if (currentSection == "description") {
-                // Append multiline description
-                if (!report.description.empty()) report.description += " ";
-                report.description += line;
+        // Consecutive reports for the same store, usually the whole batch, go in with one add
+        ReportStore* batchStore = nullptr;
+        bool batchRaw = false;
+        auto flush = [&]() {
+            if (!reportBatch.empty()) batchStore->add(reportBatch, now);
+            if (!rawBatch.empty()) batchStore->add(rawBatch, now);
+        };
+        for (PendingReport& pending : pendingReports) {
+            // A MESSAGE for a subscription this session already left still lands under its destination
+            SubscriptionRegistry::Subscription* target = pending.subscribed ? subscriptions.resolve(pending.subscription) : nullptr;
+            ReportStore* store = target != nullptr ? target->store
+                                                   : &storeFor(std::string_view(pendingText).substr(pending.topicOffset, pending.topicLength));
+            if (store != batchStore || pending.raw != batchRaw) {
+                if (batchStore != nullptr) flush();
+                batchStore = store;
+                batchRaw = pending.raw;
+            }
+            if (pending.raw) {
+                rawBatch.emplace_back();
+                rawBatch.back().header = pending.header;
+                rawBatch.back().body = std::string_view(pendingText).substr(pending.bodyOffset, pending.bodyLength);
+            } else {
+                reportBatch.push_back(std::move(pendingDecoded[pending.report]));
             }
         }
-
-        reportStorage[key].push_back(report);
-        //std::cout << "Report stored successfully for key: " << key << "\n";
+        flush();
+        Metrics::increment(Metrics::ReportsStored, pendingReports.size());
 
     } catch (const std::exception& e) {
         std::cerr << "Error while storing report: " << e.what() << "\n";
     }
+    pendingReports.clear();
+    pendingDecoded.clear();
+    pendingText.clear();
+    reportBatch.clear();
+    rawBatch.clear();
 }
 
 std::vector<Report> StompProtocol::getReports(const std::string& topic, const std::string& user) {
-    std::lock_guard<std::mutex> lock(protocolMutex);
-    std::string key = topic + ":" + user;
-    if (reportStorage.find(key) != reportStorage.end()) {
-        return reportStorage[key];
+    ReportQuery query;
+    query.user = user;
+    return queryReports(topic, query);
+}
+
+std::vector<Report> StompProtocol::queryReports(const std::string& topic, const ReportQuery& query) {
+    auto lock = Metrics::timedLock(protocolMutex, Metrics::ProtocolLockWait);
+    auto it = reportStorage.find(topic);
+    if (it == reportStorage.end()) {
+        return {}; // No reports found
+    }
+    it->second.enforceRetention(std::time(nullptr));
+    return it->second.query(query);
+}
+
+void StompProtocol::setRetention(const std::string& topic, const RetentionPolicy& policy) {
+    auto lock = Metrics::timedLock(protocolMutex, Metrics::ProtocolLockWait);
+    long now = std::time(nullptr);
+    if (topic.empty()) {
+        defaultRetention = policy;
+        for (auto& [storeTopic, store] : reportStorage) {
+            if (retentionPolicies.find(storeTopic) == retentionPolicies.end()) {
+                store.setRetention(policy, now);
+            }
+        }
+        return;
+    }
+    retentionPolicies[topic] = policy;
+    auto it = reportStorage.find(topic);
+    if (it != reportStorage.end()) {
+        it->second.setRetention(policy, now);
+    }
+}
+
+std::map<std::string, ReportStoreUsage> StompProtocol::getMemoryUsage() {
+    auto lock = Metrics::timedLock(protocolMutex, Metrics::ProtocolLockWait);
+    std::map<std::string, ReportStoreUsage> usage;
+    long now = std::time(nullptr);
+    for (auto& [topic, store] : reportStorage) {
+        store.enforceRetention(now);
+        usage[topic] = store.usage();
+    }
+    return usage;
+}
+
+void StompProtocol::setLazyParsing(bool lazy) {
+    lazyParsing = lazy;
+}
+
+std::vector<std::pair<std::string, std::string>> StompProtocol::getReportKeys() {
+    auto lock = Metrics::timedLock(protocolMutex, Metrics::ProtocolLockWait);
+    std::vector<std::pair<std::string, std::string>> keys;
+    for (const auto& [topic, store] : reportStorage) {
+        for (const std::string& user : store.users()) {
+            keys.emplace_back(topic, user);
+        }
     }
-    return {}; // No reports found
+    return keys;
 }
 
-void StompProtocol::joinTopic(const std::string& topic) {
-        std::lock_guard<std::mutex> lock(protocolMutex); // Ensure thread safety
-        joinedTopics.insert(topic);
+int StompProtocol::joinTopic(const std::string& topic) {
+    auto lock = Metrics::timedLock(protocolMutex, Metrics::ProtocolLockWait); // Ensure thread safety
+    return subscriptions.add(topic, &storeFor(topic));
 }
 
-void StompProtocol::exitTopic(const std::string& topic) {
-    std::lock_guard<std::mutex> lock(protocolMutex); // Ensure thread safety
-    joinedTopics.erase(topic);
+int StompProtocol::exitTopic(const std::string& topic) {
+    auto lock = Metrics::timedLock(protocolMutex, Metrics::ProtocolLockWait); // Ensure thread safety
+    return subscriptions.remove(topic);
 }
 
 bool StompProtocol::isSubscribed(const std::string& topic) {
-    std::lock_guard<std::mutex> lock(protocolMutex); // Ensure thread safety
-    return joinedTopics.find(topic) != joinedTopics.end();
+    auto lock = Metrics::timedLock(protocolMutex, Metrics::ProtocolLockWait); // Ensure thread safety
+    return subscriptions.find(topic) >= 0;
+}
+
+std::vector<std::pair<std::string, int>> StompProtocol::getSubscriptions() {
+    auto lock = Metrics::timedLock(protocolMutex, Metrics::ProtocolLockWait);
+    return subscriptions.active();
 }
 
  // Check login status
@@ -210,5 +309,22 @@ bool StompProtocol::isLoggedIn(){
 
 // Set login status
 void StompProtocol::setLoggedIn(bool status) {
-    loggedIn = status;
+    {
+        std::lock_guard<std::mutex> lock(protocolMutex);
+        loggedIn = status;
+    }
+    stateChanged.notify_all();
+}
+
+bool StompProtocol::waitForConnected(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(protocolMutex);
+    stateChanged.wait_for(lock, timeout, [this]() { return connected || !loggedIn; });
+    return connected && loggedIn;
+}
+
+bool StompProtocol::waitForReceipt(int receiptId, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(protocolMutex);
+    auto received = [this, receiptId]() { return receivedReceipts.count(receiptId) != 0; };
+    stateChanged.wait_for(lock, timeout, [this, &received]() { return received() || !loggedIn; });
+    return received();
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include "../include/SubscriptionRegistry.h"
+
+SubscriptionRegistry::SubscriptionRegistry() : slots(), freeSlots() {}
+
+// Ids stay positive ints: the generation keeps the bits above the slot index, less the sign bit
+int SubscriptionRegistry::idOf(uint32_t slot, uint32_t generation) {
+    constexpr uint32_t generationMask = (uint32_t(1) << (31 - SLOT_BITS)) - 1;
+    return int(((generation & generationMask) << SLOT_BITS) | slot);
+}
+
+int SubscriptionRegistry::add(const std::string& destination, ReportStore* store) {
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else if (slots.size() < MAX_SLOTS) {
+        slot = slots.size();
+        slots.emplace_back();
+    } else {
+        return -1;
+    }
+    Subscription& subscription = slots[slot];
+    subscription.destination = destination;
+    subscription.store = store;
+    subscription.active = true;
+    return idOf(slot, subscription.generation);
+}
+
+int SubscriptionRegistry::remove(const std::string& destination) {
+    int id = find(destination);
+    if (id < 0) return -1;
+    uint32_t slot = uint32_t(id) & (MAX_SLOTS - 1);
+    Subscription& subscription = slots[slot];
+    subscription.active = false;
+    subscription.store = nullptr;
+    ++subscription.generation;
+    freeSlots.push_back(slot);
+    return id;
+}
+
+int SubscriptionRegistry::find(const std::string& destination) const {
+    // Joins and exits are rare and a session has few channels, so a scan is enough here
+    for (uint32_t slot = 0; slot < slots.size(); ++slot) {
+        if (slots[slot].active && slots[slot].destination == destination) return idOf(slot, slots[slot].generation);
+    }
+    return -1;
+}
+
+SubscriptionRegistry::Subscription* SubscriptionRegistry::resolve(uint32_t id) {
+    uint32_t slot = id & (MAX_SLOTS - 1);
+    if (slot >= slots.size()) return nullptr;
+    Subscription& subscription = slots[slot];
+    if (!subscription.active || idOf(slot, subscription.generation) != int(id)) return nullptr;
+    return &subscription;
+}
+
+std::vector<std::pair<std::string, int>> SubscriptionRegistry::active() const {
+    std::vector<std::pair<std::string, int>> subscriptions;
+    for (uint32_t slot = 0; slot < slots.size(); ++slot) {
+        if (slots[slot].active) subscriptions.emplace_back(slots[slot].destination, idOf(slot, slots[slot].generation));
+    }
+    return subscriptions;
+}
@@ -0,0 +1,118 @@
+#include "../include/TimerWheel.h"
+#include "../include/Trace.h"
+#include <algorithm>
+
+constexpr std::chrono::milliseconds TimerWheel::TICK;
+
+TimerWheel::Timer::Timer(std::function<std::chrono::milliseconds()> callback)
+    : callback(std::move(callback)), prev(nullptr), next(nullptr), slot(nullptr), expires(0) {}
+
+TimerWheel& TimerWheel::instance() {
+    static TimerWheel wheel;
+    return wheel;
+}
+
+TimerWheel::TimerWheel()
+    : mutex(), changed(), slots(), current(0), epoch(std::chrono::steady_clock::now()), scheduled(0),
+      running(nullptr), stopping(false), thread() {}
+
+TimerWheel::~TimerWheel() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    if (thread.joinable()) thread.join();
+}
+
+void TimerWheel::schedule(Timer& timer, std::chrono::milliseconds delay) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (timer.slot != nullptr) unlink(timer);
+    if (scheduled == 0) {
+        // Nothing was due while idle, so the wheel can jump to the present without processing ticks
+        current = std::max<uint64_t>(current, (std::chrono::steady_clock::now() - epoch) / TICK);
+        changed.notify_all();
+    }
+    uint64_t ticks = (delay + TICK - std::chrono::milliseconds(1)) / TICK;
+    timer.expires = current + std::max<uint64_t>(ticks, 1);
+    link(timer);
+    if (!thread.joinable()) thread = std::thread(&TimerWheel::run, this);
+}
+
+void TimerWheel::cancel(Timer& timer) {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&] { return running != &timer; });
+    if (timer.slot != nullptr) unlink(timer);
+}
+
+void TimerWheel::link(Timer& timer) {
+    uint64_t delta = timer.expires - current;
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= uint64_t(1) << (SLOT_BITS * (level + 1))) ++level;
+    uint64_t range = uint64_t(1) << (SLOT_BITS * LEVELS);
+    if (delta >= range) timer.expires = current + range - 1;
+
+    Timer*& head = slots[level][(timer.expires >> (SLOT_BITS * level)) & (SLOTS - 1)];
+    timer.prev = nullptr;
+    timer.next = head;
+    if (head != nullptr) head->prev = &timer;
+    head = &timer;
+    timer.slot = &head;
+    ++scheduled;
+}
+
+void TimerWheel::unlink(Timer& timer) {
+    if (timer.prev != nullptr) timer.prev->next = timer.next;
+    else *timer.slot = timer.next;
+    if (timer.next != nullptr) timer.next->prev = timer.prev;
+    timer.prev = nullptr;
+    timer.next = nullptr;
+    timer.slot = nullptr;
+    --scheduled;
+}
+
+// Processes tick current + 1. Called with the mutex held through lock.
+void TimerWheel::advance(std::unique_lock<std::mutex>& lock) {
+    ++current;
+    // When a level turns over, the next slot of the level above moves down to where it now fits
+    for (int level = 1; level < LEVELS; ++level) {
+        if ((current & ((uint64_t(1) << (SLOT_BITS * level)) - 1)) != 0) break;
+        Timer*& head = slots[level][(current >> (SLOT_BITS * level)) & (SLOTS - 1)];
+        while (head != nullptr) {
+            Timer* timer = head;
+            unlink(*timer);
+            link(*timer);
+        }
+    }
+
+    Timer*& due = slots[0][current & (SLOTS - 1)];
+    while (due != nullptr) {
+        Timer* timer = due;
+        unlink(*timer);
+        running = timer;
+        lock.unlock();
+        std::chrono::milliseconds next = timer->callback();
+        lock.lock();
+        running = nullptr;
+        if (next.count() > 0 && timer->slot == nullptr) {
+            uint64_t ticks = (next + TICK - std::chrono::milliseconds(1)) / TICK;
+            timer->expires = current + std::max<uint64_t>(ticks, 1);
+            link(*timer);
+        }
+        changed.notify_all();
+    }
+}
+
+void TimerWheel::run() {
+    Trace::setThreadName("timers");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (scheduled == 0) {
+            changed.wait(lock, [this] { return stopping || scheduled > 0; });
+            continue;
+        }
+        changed.wait_until(lock, epoch + TICK * (current + 1));
+        uint64_t now = (std::chrono::steady_clock::now() - epoch) / TICK;
+        while (current < now && scheduled > 0 && !stopping) advance(lock);
+    }
+}
@@ -0,0 +1,168 @@
+#include "../include/Trace.h"
+#include "../include/Metrics.h"
+#include <fstream>
+#include <iomanip>
+#include <unistd.h>
+
+struct Trace::ThreadBuffer {
+    uint32_t tid;
+    std::atomic<const char*> threadName;
+    std::atomic<uint32_t> generation; // trace this buffer's events belong to
+    std::atomic<size_t> count;        // events published so far
+    std::atomic<size_t> dropped;
+    std::unique_ptr<Event[]> events; // allocated by the first record, before generation is published
+
+    explicit ThreadBuffer(uint32_t tid)
+        : tid(tid), threadName(nullptr), generation(0), count(0), dropped(0), events() {}
+};
+
+// A thread's claim on a buffer, given back to the pool when the thread exits
+struct Trace::BufferLease {
+    ThreadBuffer* buffer;
+    BufferLease() : buffer(nullptr) {}
+    ~BufferLease() {
+        if (buffer == nullptr) return;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        freeBuffers().push_back(buffer);
+    }
+    BufferLease(const BufferLease&) = delete;
+    BufferLease& operator=(const BufferLease&) = delete;
+};
+
+std::atomic<bool> Trace::active(false);
+std::atomic<uint32_t> Trace::generation(0);
+uint64_t Trace::origin = 0;
+std::mutex Trace::registryMutex;
+
+std::vector<std::unique_ptr<Trace::ThreadBuffer>>& Trace::registry() {
+    static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    return buffers;
+}
+
+std::vector<Trace::ThreadBuffer*>& Trace::freeBuffers() {
+    static std::vector<ThreadBuffer*> buffers;
+    return buffers;
+}
+
+Trace::ThreadBuffer& Trace::localBuffer() {
+    thread_local BufferLease lease;
+    if (lease.buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        if (!freeBuffers().empty()) {
+            lease.buffer = freeBuffers().back();
+            freeBuffers().pop_back();
+            lease.buffer->threadName.store(nullptr, std::memory_order_relaxed);
+        } else {
+            registry().push_back(std::make_unique<ThreadBuffer>(registry().size() + 1));
+            lease.buffer = registry().back().get();
+        }
+    }
+    return *lease.buffer;
+}
+
+void Trace::start() {
+    origin = Metrics::now();
+    generation.fetch_add(1, std::memory_order_release);
+    active.store(true, std::memory_order_release);
+}
+
+void Trace::record(const char* name, uint64_t startNanos, uint64_t endNanos) {
+    ThreadBuffer& buffer = localBuffer();
+
+    // The first event of a new trace in this thread discards the old ones
+    uint32_t current = generation.load(std::memory_order_acquire);
+    if (buffer.generation.load(std::memory_order_relaxed) != current) {
+        if (!buffer.events) buffer.events.reset(new Event[EVENTS_PER_THREAD]);
+        buffer.count.store(0, std::memory_order_relaxed);
+        buffer.dropped.store(0, std::memory_order_relaxed);
+        buffer.generation.store(current, std::memory_order_release);
+    }
+
+    size_t index = buffer.count.load(std::memory_order_relaxed);
+    if (index == EVENTS_PER_THREAD) {
+        buffer.dropped.store(buffer.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events[index] = Event{name, startNanos, endNanos};
+    buffer.count.store(index + 1, std::memory_order_release);
+}
+
+void Trace::setThreadName(const char* name) {
+    localBuffer().threadName.store(name, std::memory_order_relaxed);
+}
+
+namespace {
+
+void writeJsonString(std::ofstream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') out << '\\';
+        if (static_cast<unsigned char>(*c) >= 0x20) out << *c;
+    }
+    out << '"';
+}
+
+// Trace-event timestamps are microseconds; keep nanosecond precision as decimals
+void writeMicros(std::ofstream& out, uint64_t nanos) {
+    out << nanos / 1000 << '.' << std::setw(3) << std::setfill('0') << nanos % 1000 << std::setfill(' ');
+}
+
+} // namespace
+
+bool Trace::stop(const std::string& path) {
+    active.store(false, std::memory_order_release);
+    uint32_t current = generation.load(std::memory_order_acquire);
+
+    std::ofstream out(path);
+    if (!out) return false;
+
+    long pid = getpid();
+    size_t dropped = 0;
+    bool first = true;
+    auto separator = [&]() {
+        if (!first) out << ",\n";
+        first = false;
+    };
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto& buffer : registry()) {
+        const char* threadName = buffer->threadName.load(std::memory_order_relaxed);
+        if (threadName != nullptr) {
+            separator();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+                << ",\"args\":{\"name\":";
+            writeJsonString(out, threadName);
+            out << "}}";
+        }
+        if (buffer->generation.load(std::memory_order_acquire) != current) continue;
+
+        size_t count = buffer->count.load(std::memory_order_acquire);
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < count; ++i) {
+            const Event& event = buffer->events[i];
+            uint64_t start = event.start > origin ? event.start - origin : 0;
+            uint64_t end = event.end > origin ? event.end - origin : 0;
+            separator();
+            out << "{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+                << ",\"ts\":";
+            writeMicros(out, start);
+            out << ",\"dur\":";
+            writeMicros(out, end - start);
+            out << "}";
+        }
+    }
+    out << "\n],\"otherData\":{\"droppedEvents\":" << dropped << "}}\n";
+    return static_cast<bool>(out);
+}
+
+TraceSpan::TraceSpan(const char* name)
+    : name(name), start(Trace::enabled() ? Metrics::now() : 0) {}
+
+TraceSpan::~TraceSpan() {
+    if (start != 0 && Trace::enabled()) {
+        Trace::record(name, start, Metrics::now());
+    }
+}
@@ -0,0 +1,391 @@
+#include "../include/UringSocket.h"
+#include "../include/Metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define EMI_HAS_IO_URING 1
+#include <deque>
+#include <vector>
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+constexpr unsigned UringSocket::BUFFER_COUNT;
+constexpr unsigned UringSocket::BUFFER_SIZE;
+
+#ifdef EMI_HAS_IO_URING
+
+namespace {
+
+int ioUringSetup(unsigned entries, io_uring_params& params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+}
+
+int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int fd, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+} // namespace
+
+struct UringSocket::Ring {
+    int fd;
+    void* rings; // submission and completion rings, mapped together
+    size_t ringsSize;
+    io_uring_sqe* sqes;
+    size_t sqesSize;
+    unsigned* sqTail;
+    unsigned* sqArray;
+    unsigned sqMask;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    io_uring_cqe* cqes;
+    unsigned localTail; // prepared up to here
+    unsigned toSubmit;
+    bool enabled; // rings set up with IORING_SETUP_R_DISABLED are enabled by their first enter
+
+    Ring()
+        : fd(-1), rings(nullptr), ringsSize(0), sqes(nullptr), sqesSize(0), sqTail(nullptr), sqArray(nullptr),
+          sqMask(0), cqHead(nullptr), cqTail(nullptr), cqMask(0), cqes(nullptr), localTail(0), toSubmit(0),
+          enabled(true) {}
+
+    ~Ring() {
+        if (sqes != nullptr) munmap(sqes, sqesSize);
+        if (rings != nullptr) munmap(rings, ringsSize);
+        if (fd >= 0) close(fd);
+    }
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    // Returns 0 or an errno
+    int setup(unsigned entries, unsigned cqEntries, unsigned flags) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        params.flags = flags | IORING_SETUP_CQSIZE;
+        params.cq_entries = cqEntries;
+        fd = ioUringSetup(entries, params);
+        if (fd < 0) return errno;
+        if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0) return ENOTSUP;
+        enabled = (flags & IORING_SETUP_R_DISABLED) == 0;
+
+        ringsSize = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                             params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        void* map = mmap(nullptr, ringsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (map == MAP_FAILED) return errno;
+        rings = map;
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        map = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (map == MAP_FAILED) return errno;
+        sqes = static_cast<io_uring_sqe*>(map);
+
+        char* base = static_cast<char*>(rings);
+        sqTail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+        sqArray = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+        sqMask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+        cqHead = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+        localTail = *sqTail;
+        return 0;
+    }
+
+    // Zeroed submission entry; callers never prepare more than the ring holds before entering
+    io_uring_sqe* prepare() {
+        unsigned index = localTail & sqMask;
+        sqArray[index] = index;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        ++localTail;
+        ++toSubmit;
+        return sqe;
+    }
+
+    // Submits what was prepared and waits for up to minComplete completions. Returns 0 or an errno.
+    int enter(unsigned minComplete) {
+        if (!enabled) {
+            if (ioUringRegister(fd, IORING_REGISTER_ENABLE_RINGS, nullptr, 0) < 0) return errno;
+            enabled = true;
+        }
+        __atomic_store_n(sqTail, localTail, __ATOMIC_RELEASE);
+        int submitted = ioUringEnter(fd, toSubmit, minComplete, minComplete > 0 ? IORING_ENTER_GETEVENTS : 0);
+        if (submitted < 0) return errno == EINTR ? 0 : errno;
+        toSubmit -= std::min<unsigned>(toSubmit, submitted);
+        return 0;
+    }
+
+    io_uring_cqe* peek() {
+        unsigned head = *cqHead;
+        if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) return nullptr;
+        return &cqes[head & cqMask];
+    }
+
+    void pop() {
+        __atomic_store_n(cqHead, *cqHead + 1, __ATOMIC_RELEASE);
+    }
+};
+
+struct UringSocket::Receiver {
+    struct Chunk {
+        unsigned short buffer;
+        unsigned offset;
+        unsigned length;
+    };
+
+    io_uring_buf_ring* ring; // shared with the kernel
+    size_t ringSize;
+    std::vector<char> memory; // BUFFER_COUNT buffers of BUFFER_SIZE
+    unsigned short tail;
+    std::deque<Chunk> chunks; // received, not copied out yet
+    bool armed;               // a multishot RECV is pending
+    bool ended;
+    int endError;
+
+    Receiver()
+        : ring(nullptr), ringSize(BUFFER_COUNT * sizeof(io_uring_buf)), memory(size_t(BUFFER_COUNT) * BUFFER_SIZE),
+          tail(0), chunks(), armed(false), ended(false), endError(0) {}
+
+    ~Receiver() {
+        if (ring != nullptr) munmap(ring, ringSize);
+    }
+
+    Receiver(const Receiver&) = delete;
+    Receiver& operator=(const Receiver&) = delete;
+
+    // Hands buffer back to the kernel. The ring is an array of io_uring_buf whose first entry's
+    // reserved field holds the tail; ring->bufs is not used because C++ headers place it after the tail.
+    void recycle(unsigned short buffer) {
+        io_uring_buf& entry = reinterpret_cast<io_uring_buf*>(ring)[tail & (BUFFER_COUNT - 1)];
+        entry.addr = reinterpret_cast<uint64_t>(memory.data() + size_t(buffer) * BUFFER_SIZE);
+        entry.len = BUFFER_SIZE;
+        entry.bid = buffer;
+        ++tail;
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    }
+};
+
+UringSocket::UringSocket()
+    : receiveRing(new Ring()), receiver(new Receiver()), sendRing(new Ring()), sendMutex(), fd(-1), quickAck(false) {}
+
+// The rings go first: closing them cancels the pending RECV before its buffers are freed
+UringSocket::~UringSocket() {
+    receiveRing.reset();
+    sendRing.reset();
+}
+
+std::unique_ptr<UringSocket> UringSocket::open(int fd, bool quickAck, std::string& error) {
+    std::unique_ptr<UringSocket> socket(new UringSocket());
+    socket->fd = fd;
+    socket->quickAck = quickAck;
+    auto fail = [&error](const char* step, int code) {
+        error = std::string(step) + ": " + std::strerror(code);
+        return std::unique_ptr<UringSocket>();
+    };
+
+    // Only the reader thread enters the receive ring, so it can defer completion work to those
+    // enters (Linux 6.1); it is enabled from that thread, which makes it the single issuer
+    int code = socket->receiveRing->setup(4, 2 * BUFFER_COUNT,
+                                          IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_R_DISABLED);
+    if (code == EINVAL) {
+        socket->receiveRing.reset(new Ring());
+        code = socket->receiveRing->setup(4, 2 * BUFFER_COUNT, 0);
+    }
+    if (code != 0) return fail("io_uring_setup", code);
+    code = socket->sendRing->setup(4, 8, 0);
+    if (code != 0) return fail("io_uring_setup", code);
+
+    for (Ring* ring : {socket->receiveRing.get(), socket->sendRing.get()}) {
+        if (ioUringRegister(ring->fd, IORING_REGISTER_FILES, &fd, 1) < 0) return fail("register socket", errno);
+    }
+
+    Receiver& receiver = *socket->receiver;
+    void* ring = mmap(nullptr, receiver.ringSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) return fail("map buffer ring", errno);
+    receiver.ring = static_cast<io_uring_buf_ring*>(ring);
+    io_uring_buf_reg registration;
+    std::memset(&registration, 0, sizeof(registration));
+    registration.ring_addr = reinterpret_cast<uint64_t>(ring);
+    registration.ring_entries = BUFFER_COUNT;
+    registration.bgid = 0;
+    if (ioUringRegister(socket->receiveRing->fd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+        return fail("register buffer ring", errno);
+    }
+    for (unsigned i = 0; i < BUFFER_COUNT; ++i) receiver.recycle(static_cast<unsigned short>(i));
+    return socket;
+}
+
+size_t UringSocket::receive(char* bytes, size_t size, int& error) {
+    Receiver& r = *receiver;
+    size_t done = 0;
+    while (true) {
+        while (done < size && !r.chunks.empty()) {
+            Receiver::Chunk& chunk = r.chunks.front();
+            size_t count = std::min<size_t>(size - done, chunk.length);
+            std::memcpy(bytes + done, r.memory.data() + size_t(chunk.buffer) * BUFFER_SIZE + chunk.offset, count);
+            done += count;
+            chunk.offset += count;
+            chunk.length -= count;
+            if (chunk.length == 0) {
+                r.recycle(chunk.buffer);
+                r.chunks.pop_front();
+            }
+        }
+        if (done > 0 || size == 0) return done;
+        if (r.ended) {
+            error = r.endError;
+            return 0;
+        }
+
+        // Rearmed when the kernel ended the multishot, e.g. after running out of buffers
+        if (!r.armed) {
+            io_uring_sqe* sqe = receiveRing->prepare();
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd = 0; // the registered socket
+            sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->buf_group = 0;
+            r.armed = true;
+        }
+        int code = receiveRing->enter(1);
+        Metrics::increment(Metrics::SocketReads);
+        if (quickAck) {
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &on, sizeof(on));
+        }
+        if (code != 0) {
+            r.ended = true;
+            r.endError = code;
+            continue;
+        }
+        bool noBuffers = false;
+        while (io_uring_cqe* cqe = receiveRing->peek()) {
+            if ((cqe->flags & IORING_CQE_F_MORE) == 0) r.armed = false;
+            if (cqe->res > 0 && (cqe->flags & IORING_CQE_F_BUFFER) != 0) {
+                unsigned short buffer = static_cast<unsigned short>(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+                r.chunks.push_back(Receiver::Chunk{buffer, 0, static_cast<unsigned>(cqe->res)});
+            } else if (cqe->res == 0) {
+                r.ended = true;
+                r.endError = 0;
+            } else if (cqe->res == -ENOBUFS) {
+                noBuffers = true;
+            } else {
+                r.ended = true;
+                r.endError = -cqe->res;
+            }
+            receiveRing->pop();
+        }
+        // Out of buffers with none of them waiting to be copied out means the kernel lost track of them
+        if (noBuffers && r.chunks.empty() && !r.ended) {
+            r.ended = true;
+            r.endError = ENOBUFS;
+        }
+    }
+}
+
+bool UringSocket::send(const char* bytes, size_t size, int& error) {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    return submitSends(bytes, size, nullptr, 0, error);
+}
+
+bool UringSocket::send(const char* first, size_t firstSize, const char* second, size_t secondSize, int& error) {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    return submitSends(first, firstSize, second, secondSize, error);
+}
+
+bool UringSocket::submitSends(const char* first, size_t firstSize, const char* second, size_t secondSize, int& error) {
+    const char* data[2] = {first, second};
+    size_t sizes[2] = {firstSize, secondSize};
+    unsigned count = second != nullptr && secondSize > 0 ? 2 : 1;
+    for (unsigned i = 0; i < count; ++i) {
+        io_uring_sqe* sqe = sendRing->prepare();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = 0;
+        sqe->flags = IOSQE_FIXED_FILE | (i + 1 < count ? IOSQE_IO_LINK : 0);
+        sqe->addr = reinterpret_cast<uint64_t>(data[i]);
+        sqe->len = static_cast<unsigned>(sizes[i]);
+        sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+        sqe->user_data = i;
+    }
+
+    int results[2] = {0, 0};
+    unsigned completed = 0;
+    while (completed < count) {
+        int code = sendRing->enter(count - completed);
+        Metrics::increment(Metrics::SocketWrites);
+        if (code != 0) {
+            error = code;
+            return false;
+        }
+        while (io_uring_cqe* cqe = sendRing->peek()) {
+            results[cqe->user_data] = cqe->res;
+            ++completed;
+            sendRing->pop();
+        }
+    }
+
+    // A short first send cancels the linked second one; send what is left of both again
+    for (unsigned i = 0; i < count; ++i) {
+        if (results[i] < 0) {
+            error = -results[i];
+            return false;
+        }
+        size_t sent = static_cast<size_t>(results[i]);
+        if (sent == 0 && sizes[i] > 0) {
+            error = EPIPE;
+            return false;
+        }
+        if (sent < sizes[i]) {
+            return i == 0 ? submitSends(first + sent, firstSize - sent, second, secondSize, error)
+                          : submitSends(second + sent, secondSize - sent, nullptr, 0, error);
+        }
+    }
+    return true;
+}
+
+#else
+
+struct UringSocket::Ring {};
+struct UringSocket::Receiver {};
+
+UringSocket::UringSocket() : receiveRing(), receiver(), sendRing(), sendMutex(), fd(-1), quickAck(false) {}
+
+UringSocket::~UringSocket() {}
+
+std::unique_ptr<UringSocket> UringSocket::open(int, bool, std::string& error) {
+    error = "not supported on this platform";
+    return std::unique_ptr<UringSocket>();
+}
+
+size_t UringSocket::receive(char*, size_t, int& error) {
+    error = ENOTSUP;
+    return 0;
+}
+
+bool UringSocket::send(const char*, size_t, int& error) {
+    error = ENOTSUP;
+    return false;
+}
+
+bool UringSocket::send(const char*, size_t, const char*, size_t, int& error) {
+    error = ENOTSUP;
+    return false;
+}
+
+bool UringSocket::submitSends(const char*, size_t, const char*, size_t, int& error) {
+    error = ENOTSUP;
+    return false;
+}
+
+#endif
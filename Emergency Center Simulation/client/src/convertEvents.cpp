@@ -0,0 +1,27 @@
+#include <iostream>
+#include <string>
+#include "../include/event.h"
+#include "../include/BinaryEventFile.h"
+
+/**
+* Converts an events_*.json file into the binary events format (see BinaryEventFile.h).
+*/
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " {input.json} {output.bin}" << std::endl;
+        return -1;
+    }
+
+    try {
+        names_and_events data = parseEventsFile(argv[1]);
+        if (!writeBinaryEventsFile(data, argv[2])) {
+            std::cerr << "Cannot write " << argv[2] << std::endl;
+            return 1;
+        }
+        std::cout << "Converted " << data.events.size() << " events to " << argv[2] << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,5 +1,7 @@
 #include "../include/event.h"
-#include "../include/json.hpp"
+#include "../include/BinaryEventFile.h"
+#include "../include/EventSource.h"
+#include "../include/ReportCodec.h"
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -7,14 +9,15 @@
 #include <vector>
 #include <sstream>
 #include <cstring>
+#include <limits>
+#include <stdexcept>
 
 using namespace std;
-using json = nlohmann::json;
 
 Event::Event(std::string channel_name, std::string city, std::string name, int date_time,
-             std::string description, std::map<std::string, std::string> general_information)
-    : channel_name(channel_name), city(city), name(name),
-      date_time(date_time), description(description), general_information(general_information), eventOwnerUser("")
+             std::string description, std::map<std::string, DetailValue> general_information)
+    : channel_name(std::move(channel_name)), city(std::move(city)), name(std::move(name)),
+      date_time(date_time), description(std::move(description)), general_information(std::move(general_information)), eventOwnerUser("")
 {
 }
 
@@ -23,7 +26,7 @@ Event::~Event()
 }
 
 void Event::setEventOwnerUser(std::string setEventOwnerUser) {
-    eventOwnerUser = setEventOwnerUser;
+    eventOwnerUser = std::move(setEventOwnerUser);
 }
 
 const std::string &Event::getEventOwnerUser() const {
@@ -50,7 +53,7 @@ int Event::get_date_time() const
     return this->date_time;
 }
 
-const std::map<std::string, std::string> &Event::get_general_information() const
+const std::map<std::string, DetailValue> &Event::get_general_information() const
 {
     return this->general_information;
 }
@@ -60,100 +63,33 @@ const std::string &Event::get_description() const
     return this->description;
 }
 
-Event::Event(const std::string &frame_body): channel_name(""), city(""), 
+Event::Event(const std::string &frame_body): channel_name(""), city(""),
                                              name(""), date_time(0), description(""), general_information(),
                                              eventOwnerUser("")
 {
-    stringstream ss(frame_body);
-    string line;
-    string eventDescription;
-    map<string, string> general_information_from_string;
-    bool inGeneralInformation = false;
-    while(getline(ss,line,'\n')){
-        vector<string> lineArgs;
-        if(line.find(':') != string::npos) {
-            split_str(line, ':', lineArgs);
-            string key = lineArgs.at(0);
-            string val;
-            if(lineArgs.size() == 2) {
-                val = lineArgs.at(1);
-            }
-            if(key == "user") {
-                eventOwnerUser = val;
-            }
-            if(key == "channel name") {
-                channel_name = val;
-            }
-            if(key == "city") {
-                city = val;
-            }
-            else if(key == "event name") {
-                name = val;
-            }
-            else if(key == "date time") {
-                date_time = std::stoi(val);
-            }
-            else if(key == "general information") {
-                inGeneralInformation = true;
-                continue;
-            }
-            else if(key == "description") {
-                while(getline(ss,line,'\n')) {
-                    eventDescription += line + "\n";
-                }
-                description = eventDescription;
-            }
-
-            if(inGeneralInformation) {
-                general_information_from_string[key.substr(1)] = val;
-            }
-        }
+    Report report;
+    if (!ReportCodec::decode(frame_body, report)) {
+        throw std::runtime_error("Malformed report body: missing user or invalid date time");
     }
-    general_information = general_information_from_string;
+    if (report.dateTime < std::numeric_limits<int>::min() || report.dateTime > std::numeric_limits<int>::max()) {
+        throw std::runtime_error("Malformed report body: date time out of range");
+    }
+    eventOwnerUser = std::move(report.user);
+    city = std::move(report.city);
+    name = std::move(report.eventName);
+    date_time = static_cast<int>(report.dateTime);
+    description = std::move(report.description);
+    general_information = std::move(report.details);
 }
 
 names_and_events parseEventsFile(std::string json_path)
 {
-    std::ifstream f(json_path);
-    if (!f) {
-        throw std::runtime_error("Error: File not found or cannot be opened - " + json_path);
-    }
-
-    json data;
-    try {
-        data = json::parse(f); // Parse the JSON file
-    } catch (const json::parse_error& e) {
-        throw std::runtime_error("JSON parse error: " + std::string(e.what()));
-    }
-
-    // Extract the channel name
-    std::string channel_name = data["channel_name"];
-
-    // Convert the events into Event objects
-    std::vector<Event> events;
-    try {
-        for (const auto& event : data["events"]) {
-            std::string name = event["event_name"];
-            std::string city = event["city"];
-            int date_time = event["date_time"];
-            std::string description = event["description"];
-            std::map<std::string, std::string> general_information;
-
-            for (const auto& update : event["general_information"].items()) {
-                if (update.value().is_string()) {
-                    general_information[update.key()] = update.value();
-                } else {
-                    general_information[update.key()] = update.value().dump();
-                }
-            }
-
-            events.emplace_back(Event(channel_name, city, name, date_time, description, general_information));
-        }
-    } catch (const std::exception& e) {
-        throw std::runtime_error("Error processing events: " + std::string(e.what()));
+    // Binary event files are recognised by their magic bytes, whatever their extension
+    if (isBinaryEventsFile(json_path)) {
+        return readBinaryEventsFile(json_path);
     }
 
-    return names_and_events{channel_name, events};
+    return EventSource::create()->load(json_path);
 }
 
 void Event::split_str(const std::string &input, char delimiter, std::vector<std::string> &output)
@@ -173,5 +109,5 @@ void Event::split_str(const std::string &input, char delimiter, std::vector<std:
 }
 
 void Event::setEventChannelName(std::string channelName){
-    channel_name = channelName;
+    channel_name = std::move(channelName);
 }
\ No newline at end of file
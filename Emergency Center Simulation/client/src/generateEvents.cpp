@@ -0,0 +1,58 @@
+#include <iostream>
+#include <string>
+#include "../include/EventGenerator.h"
+#include "../include/BinaryEventFile.h"
+
+/**
+* Writes a synthetic events_*.json file (or its binary form) for benchmarking the report pipeline.
+*/
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " {output.json} {event_count} [--channel name] [--seed N]"
+                  << " [--description-length N] [--binary]" << std::endl;
+        return -1;
+    }
+
+    EventGeneratorOptions options;
+    std::string outputPath = argv[1];
+    bool binary = false;
+    try {
+        options.eventCount = std::stoul(argv[2]);
+        for (int i = 3; i < argc; i += 2) {
+            std::string flag = argv[i];
+            if (flag == "--binary") {
+                binary = true;
+                --i;
+                continue;
+            }
+            if (i + 1 == argc) {
+                std::cerr << "Missing value for " << flag << std::endl;
+                return -1;
+            }
+            if (flag == "--channel") {
+                options.channel = argv[i + 1];
+            } else if (flag == "--seed") {
+                options.seed = std::stoul(argv[i + 1]);
+            } else if (flag == "--description-length") {
+                options.meanDescriptionLength = std::stoul(argv[i + 1]);
+            } else {
+                std::cerr << "Unknown option " << flag << std::endl;
+                return -1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid number: " << e.what() << std::endl;
+        return -1;
+    }
+
+    EventGenerator generator(options);
+    names_and_events data = generator.generate();
+    bool written = binary ? writeBinaryEventsFile(data, outputPath) : EventGenerator::writeJson(data, outputPath);
+    if (!written) {
+        std::cerr << "Cannot write " << outputPath << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << data.events.size() << " events on channel " << data.channel_name
+              << " to " << outputPath << std::endl;
+    return 0;
+}
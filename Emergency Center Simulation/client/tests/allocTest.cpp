@@ -0,0 +1,101 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include "../include/BinaryEventFile.h"
+#include "../include/EventGenerator.h"
+#include "../include/EventSource.h"
+
+/**
+* Counts the heap allocations each events file loader makes per event and
+* checks them against what the loaded events have to own: one per string too
+* long for the small string buffer, one per general_information node and one
+* per detail string too long to be interned. Interned detail strings are
+* shared by every event and left out.
+*/
+namespace {
+
+std::atomic<size_t> allocations(0);
+
+const size_t EVENT_COUNT = 20000;
+const char* const JSON_PATH = "bin/allocTest.json";
+const char* const BINARY_PATH = "bin/allocTest.bin";
+
+// Allocations a loader may make per event beyond what the events own: its read buffer, the
+// events vector and the interned strings amortise to a small fraction of one, while nlohmann's
+// DOM costs about one per JSON value
+const double FAST_SLACK = 0.1;
+const double BINARY_SLACK = 0.1;
+const double NLOHMANN_SLACK = 20;
+
+size_t ownedAllocations(const names_and_events& data) {
+    auto heap = [](const std::string& s) { return s.size() > 15 ? 1 : 0; };
+    size_t owned = 0;
+    for (const Event& event : data.events) {
+        owned += heap(event.get_name()) + heap(event.get_city()) + heap(event.get_description()) +
+                 heap(event.get_channel_name()) + heap(event.getEventOwnerUser());
+        for (const auto& [key, value] : event.get_general_information()) {
+            owned += 1 + heap(key);
+            if (value.kind() == DetailValue::String && value.asString().size() > DetailValue::MAX_INTERNED_LENGTH) ++owned;
+        }
+    }
+    return owned;
+}
+
+template <typename Load>
+bool check(const char* name, double slack, Load load) {
+    size_t before = allocations.load();
+    names_and_events data = load();
+    size_t made = allocations.load() - before;
+    double perEvent = double(made) / data.events.size();
+    double ownedPerEvent = double(ownedAllocations(data)) / data.events.size();
+    bool ok = data.events.size() == EVENT_COUNT && perEvent <= ownedPerEvent + slack;
+    std::cout << name << ": " << perEvent << " allocations per event, " << ownedPerEvent << " owned, limit "
+              << ownedPerEvent + slack << (ok ? "" : "  FAILED") << std::endl;
+    return ok;
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+int main() {
+    EventGeneratorOptions options;
+    options.eventCount = EVENT_COUNT;
+    options.channel = "police";
+    {
+        EventGenerator generator(options);
+        names_and_events data = generator.generate();
+        if (!EventGenerator::writeJson(data, JSON_PATH) || !writeBinaryEventsFile(data, BINARY_PATH)) {
+            std::cerr << "Cannot write the test files under bin/" << std::endl;
+            return 1;
+        }
+    }
+
+    bool ok = true;
+    for (const char* backend : {"fast", "nlohmann"}) {
+        std::unique_ptr<EventSource> source = EventSource::create(backend);
+        ok = check(backend, std::string(backend) == "fast" ? FAST_SLACK : NLOHMANN_SLACK,
+                   [&] { return source->load(JSON_PATH); }) && ok;
+    }
+    ok = check("binary", BINARY_SLACK, [] { return readBinaryEventsFile(BINARY_PATH); }) && ok;
+
+    std::remove(JSON_PATH);
+    std::remove(BINARY_PATH);
+    std::cout << (ok ? "allocation test passed" : "allocation test FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../include/BinaryEventFile.h"
+#include "../include/EventGenerator.h"
+
+/**
+* Writes generated events as JSON and as a binary events file, loads both
+* through parseEventsFile and checks that each gives back exactly the
+* generated events. Then measures file size and load time for both formats;
+* the binary file must be smaller and load faster. Finally truncates and
+* corrupts copies of a small binary file: loading one may throw runtime_error
+* or return some events, but must not crash or read past the file.
+*/
+namespace {
+
+const size_t EVENT_COUNT = 50000;
+const int LOAD_PASSES = 3;
+const size_t DAMAGED_FILES = 2000;
+const size_t DAMAGED_EVENTS = 200;
+const char* const JSON_PATH = "bin/binaryEventsBench.json";
+const char* const BINARY_PATH = "bin/binaryEventsBench.bin";
+const char* const DAMAGED_PATH = "bin/binaryEventsBench.damaged.bin";
+
+// The first event that differs, or -1 if a and b hold the same events
+long firstDifference(const names_and_events& a, const names_and_events& b) {
+    if (a.channel_name != b.channel_name) return 0;
+    size_t count = std::min(a.events.size(), b.events.size());
+    for (size_t i = 0; i < count; ++i) {
+        const Event& x = a.events[i];
+        const Event& y = b.events[i];
+        if (x.get_channel_name() != y.get_channel_name() || x.get_name() != y.get_name() || x.get_city() != y.get_city() ||
+            x.get_date_time() != y.get_date_time() || x.get_description() != y.get_description() ||
+            x.get_general_information() != y.get_general_information()) {
+            return static_cast<long>(i);
+        }
+    }
+    return a.events.size() == b.events.size() ? -1 : static_cast<long>(count);
+}
+
+size_t fileSize(const char* path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    return in ? static_cast<size_t>(in.tellg()) : 0;
+}
+
+// Seconds of the fastest of LOAD_PASSES loads of path; data is what the last one loaded
+double load(const char* path, names_and_events& data) {
+    double best = 0;
+    for (int pass = 0; pass < LOAD_PASSES; ++pass) {
+        auto start = std::chrono::steady_clock::now();
+        data = parseEventsFile(path);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (pass == 0 || seconds < best) best = seconds;
+    }
+    return best;
+}
+
+// Loads truncated and byte-flipped copies of a small binary file of the first DAMAGED_EVENTS
+// events; counts how many loaded and how many threw
+void damage(const names_and_events& generated, size_t& loaded, size_t& rejected) {
+    names_and_events small{generated.channel_name, {generated.events.begin(), generated.events.begin() + DAMAGED_EVENTS}};
+    writeBinaryEventsFile(small, DAMAGED_PATH);
+    std::ifstream in(DAMAGED_PATH, std::ios::binary);
+    std::string original((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::mt19937 rng(34);
+    for (size_t i = 0; i < DAMAGED_FILES; ++i) {
+        std::string bytes = original;
+        if (i % 2 == 0) {
+            // Cuts near the front hit the header and string table, the rest anywhere
+            bytes.resize(i % 4 == 0 ? rng() % 4096 : rng() % bytes.size());
+        } else {
+            for (int k = 0; k < 8; ++k) bytes[rng() % bytes.size()] = static_cast<char>(rng() % 256);
+        }
+        // Keep the magic bytes so parseEventsFile takes the file as binary
+        std::copy(BINARY_EVENTS_MAGIC, BINARY_EVENTS_MAGIC + std::min<size_t>(4, bytes.size()), bytes.begin());
+        std::ofstream(DAMAGED_PATH, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+        try {
+            readBinaryEventsFile(DAMAGED_PATH);
+            ++loaded;
+        } catch (const std::runtime_error&) {
+            ++rejected;
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    EventGeneratorOptions options;
+    options.eventCount = EVENT_COUNT;
+    EventGenerator generator(options);
+    names_and_events generated = generator.generate();
+    if (!EventGenerator::writeJson(generated, JSON_PATH) || !writeBinaryEventsFile(generated, BINARY_PATH)) {
+        std::cerr << "Cannot write the test files under bin/" << std::endl;
+        return 1;
+    }
+
+    bool ok = true;
+    names_and_events fromJson{"", {}};
+    names_and_events fromBinary{"", {}};
+    double jsonSeconds = load(JSON_PATH, fromJson);
+    double binarySeconds = load(BINARY_PATH, fromBinary);
+    for (const auto& [format, data] : {std::make_pair("JSON", &fromJson), std::make_pair("binary", &fromBinary)}) {
+        long difference = firstDifference(generated, *data);
+        if (difference >= 0) {
+            std::cout << "FAILED: the " << format << " file loads differently from event " << difference << std::endl;
+            ok = false;
+        }
+    }
+
+    size_t jsonBytes = fileSize(JSON_PATH);
+    size_t binaryBytes = fileSize(BINARY_PATH);
+    std::cout << EVENT_COUNT << " generated events:\n"
+              << "  JSON:   " << jsonBytes / 1e6 << " MB, loads in " << jsonSeconds * 1e3 << " ms ("
+              << EVENT_COUNT / jsonSeconds << " events/s)\n"
+              << "  binary: " << binaryBytes / 1e6 << " MB, loads in " << binarySeconds * 1e3 << " ms ("
+              << EVENT_COUNT / binarySeconds << " events/s)" << std::endl;
+    if (binaryBytes >= jsonBytes || binarySeconds >= jsonSeconds) {
+        std::cout << "FAILED: the binary file is not smaller and faster to load than JSON" << std::endl;
+        ok = false;
+    }
+
+    size_t loaded = 0;
+    size_t rejected = 0;
+    damage(generated, loaded, rejected);
+    std::cout << DAMAGED_FILES << " truncated or corrupted binary files: " << rejected << " rejected, " << loaded
+              << " loaded" << std::endl;
+
+    std::remove(JSON_PATH);
+    std::remove(BINARY_PATH);
+    std::remove(DAMAGED_PATH);
+    std::cout << (ok ? "binary events benchmark passed" : "binary events benchmark FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../include/EventGenerator.h"
+#include "../include/ReportCodec.h"
+
+/**
+* Round-trips random events through ReportCodec: encode, then decode the body
+* as it is and as the server passes it on (empty lines dropped, the whole body
+* trimmed), and compare with what the codec promises to keep and with what
+* scan reads of the same body. Then measures encode and decode throughput on
+* generated events against the ostringstream writer and the getline reader the
+* codec replaced; the codec may not be slower than either.
+*/
+namespace {
+
+const size_t ROUND_TRIPS = 200000;
+const size_t BENCHMARK_EVENTS = 20000;
+const int BENCHMARK_PASSES = 5;
+const size_t MAX_REPORTED = 5;
+
+// Results of the benchmarked work, kept so the compiler cannot drop it
+volatile size_t benchmarkSink = 0;
+
+std::string trim(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) return "";
+    return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+}
+
+// What the server does to a SEND body before fanning it out as a MESSAGE
+std::string serverBody(const std::string& body) {
+    std::string kept;
+    std::stringstream ss(body);
+    std::string line;
+    while (std::getline(ss, line)) {
+        if (!line.empty()) kept += line + "\n";
+    }
+    size_t first = kept.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return "\n";
+    return kept.substr(first, kept.find_last_not_of(" \t\r\n") - first + 1) + "\n";
+}
+
+// The description as decode reads it back: lines trimmed, empty ones dropped, joined with spaces
+std::string expectedDescription(const std::string& description) {
+    std::string expected;
+    std::stringstream ss(description);
+    std::string line;
+    while (std::getline(ss, line)) {
+        line = trim(line);
+        if (line.empty()) continue;
+        if (!expected.empty()) expected += ' ';
+        expected += line;
+    }
+    return expected;
+}
+
+// Whether ReportCodec::scan reads from body what decode read into report
+bool scanAgrees(std::string_view body, const Report& report) {
+    ReportHeader header;
+    if (!ReportCodec::scan(body, header)) return false;
+    auto isTrue = [&report](const char* key) {
+        auto it = report.details.find(key);
+        return it != report.details.end() && it->second.isTrue();
+    };
+    return header.user(body) == report.user && header.city(body) == report.city && header.dateTime == report.dateTime &&
+           header.active == isTrue("active") && header.forcesArrived == isTrue("forces_arrival_at_scene");
+}
+
+class Fuzzer {
+private:
+    std::mt19937 rng;
+
+    size_t below(size_t n) { return rng() % n; }
+
+    // Up to maxLength pieces, colons included; newlines only where a field may hold them
+    std::string text(size_t maxLength, bool colons, bool newlines) {
+        static const char* const pieces[] = {"a", "b", "Z", " ", "\t", ":", "\xc3\xa9", "1", "x y", "-", "\r"};
+        std::string text;
+        for (size_t i = below(maxLength + 1); i > 0; --i) {
+            std::string piece = pieces[below(sizeof(pieces) / sizeof(*pieces))];
+            if (!colons && piece == ":") piece = "c";
+            text += piece;
+            if (newlines && below(6) == 0) text += below(2) ? "\n" : "\n\n  ";
+        }
+        return text;
+    }
+
+    DetailValue value() {
+        switch (below(4)) {
+            case 0: return DetailValue::fromBool(below(2) == 0);
+            case 1: return DetailValue::fromInt(static_cast<int64_t>(rng()) - (int64_t(1) << 31));
+            case 2: return DetailValue::fromDouble(static_cast<double>(rng()) / (1 + below(1000)));
+            default: return DetailValue::fromString(trim(text(12, true, false)));
+        }
+    }
+
+public:
+    Fuzzer() : rng(38) {}
+
+    bool roundTrip(size_t& reported) {
+        std::string user = trim(text(8, true, false));
+        if (user.empty()) user = "u";
+        std::map<std::string, DetailValue> details;
+        for (size_t i = below(5); i > 0; --i) {
+            std::string key = trim(text(8, false, false));
+            if (key.empty() || key == "description") key = "k";
+            if (below(8) == 0) key = below(2) ? "active" : "forces_arrival_at_scene";
+            details[key] = value();
+        }
+        int dateTime = static_cast<int>(rng());
+        Event event("police", text(10, true, false), text(10, true, false), dateTime, text(60, true, true), details);
+
+        std::string body;
+        ReportCodec::encode(user, event, body);
+        // A string spelled like a boolean or a number comes back as one; its text is what survives
+        std::map<std::string, DetailValue> expectedDetails;
+        for (const auto& [key, detail] : details) expectedDetails[key] = DetailValue::parse(trim(detail.toString()));
+
+        bool ok = true;
+        for (const std::string& received : {body, serverBody(body)}) {
+            Report report;
+            const char* mismatch = nullptr;
+            if (!ReportCodec::decode(received, report)) mismatch = "decode failed";
+            else if (report.user != user) mismatch = "user";
+            else if (report.city != trim(event.get_city())) mismatch = "city";
+            else if (report.eventName != trim(event.get_name())) mismatch = "event name";
+            else if (report.dateTime != dateTime) mismatch = "date time";
+            else if (report.description != expectedDescription(event.get_description())) mismatch = "description";
+            else if (report.details != expectedDetails) mismatch = "details";
+            else if (!scanAgrees(received, report)) mismatch = "scan";
+            if (mismatch != nullptr) {
+                ok = false;
+                if (++reported <= MAX_REPORTED) std::cout << "FAILED: " << mismatch << " for body:\n" << received << "---" << std::endl;
+            }
+        }
+        return ok;
+    }
+};
+
+// The getline reader StompProtocol::storeReport used before ReportCodec, details kept as text
+struct LegacyReport {
+    std::string city;
+    std::string eventName;
+    long dateTime;
+    std::string description;
+    std::map<std::string, std::string> details;
+    LegacyReport() : city(), eventName(), dateTime(0), description(), details() {}
+};
+
+LegacyReport legacyDecode(const std::string& content) {
+    LegacyReport report;
+    std::istringstream stream(content);
+    std::string line;
+    std::string currentSection;
+    while (std::getline(stream, line)) {
+        line.erase(0, line.find_first_not_of(" \t"));
+        line.erase(line.find_last_not_of(" \t") + 1);
+        if (line.empty()) continue;
+        size_t colonPos = line.find(':');
+        if (colonPos != std::string::npos) {
+            std::string field = line.substr(0, colonPos);
+            std::string value = line.substr(colonPos + 1);
+            value.erase(0, value.find_first_not_of(" \t"));
+            if (field == "user") {
+            } else if (field == "city") {
+                report.city = value;
+            } else if (field == "event name") {
+                report.eventName = value;
+            } else if (field == "date time") {
+                report.dateTime = std::stol(value);
+            } else if (field == "description") {
+                currentSection = "description";
+                report.description = value;
+            } else if (field == "general information") {
+                currentSection = "general_information";
+            } else if (currentSection == "general_information") {
+                report.details[field] = value;
+            }
+        } else if (currentSection == "description") {
+            if (!report.description.empty()) report.description += " ";
+            report.description += line;
+        }
+    }
+    return report;
+}
+
+// The ostringstream writer handleReport used before ReportCodec
+std::string legacyEncode(const std::string& user, const Event& event) {
+    std::ostringstream body;
+    body << "user:" << user << "\n"
+         << "city:" << event.get_city() << "\n"
+         << "event name:" << event.get_name() << "\n"
+         << "date time:" << event.get_date_time() << "\n"
+         << "general information:\n";
+    for (const auto& [key, value] : event.get_general_information()) {
+        body << "        " << key << ":" << value.toString() << "\n";
+    }
+    body << "description:\n" << event.get_description() << "\n";
+    return body.str();
+}
+
+// Events per second of the best of BENCHMARK_PASSES runs of work over events
+template <typename Work>
+double rate(const std::vector<Event>& events, Work work) {
+    double best = 0;
+    size_t sink = 0;
+    for (int pass = 0; pass < BENCHMARK_PASSES; ++pass) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < events.size(); ++i) sink += work(i);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = std::max(best, events.size() / seconds);
+    }
+    benchmarkSink = sink;
+    return best;
+}
+
+// Whether encode and decode are at least as fast as the writer and reader they replaced
+bool benchmark() {
+    EventGeneratorOptions options;
+    options.eventCount = BENCHMARK_EVENTS;
+    options.channel = "police";
+    EventGenerator generator(options);
+    std::vector<Event> events = generator.generate().events;
+
+    std::vector<std::string> bodies;
+    size_t bytes = 0;
+    for (const Event& event : events) {
+        bodies.emplace_back();
+        ReportCodec::encode("reporter", event, bodies.back());
+        bytes += bodies.back().size();
+    }
+
+    double legacyEncodeRate = rate(events, [&](size_t i) { return legacyEncode("reporter", events[i]).size(); });
+    std::string body;
+    double encodeRate = rate(events, [&](size_t i) {
+        body.clear();
+        ReportCodec::encode("reporter", events[i], body);
+        return body.size();
+    });
+    double legacyDecodeRate = rate(events, [&](size_t i) { return legacyDecode(bodies[i]).details.size(); });
+    double decodeRate = rate(events, [&](size_t i) {
+        Report report;
+        ReportCodec::decode(bodies[i], report);
+        return report.details.size();
+    });
+
+    double meanBody = double(bytes) / events.size();
+    std::cout << "throughput over " << events.size() << " generated events, " << meanBody << " byte bodies:\n"
+              << "  encode: " << encodeRate << " events/s (" << encodeRate * meanBody / 1e6 << " MB/s), ostringstream "
+              << legacyEncodeRate << " events/s\n"
+              << "  decode: " << decodeRate << " events/s (" << decodeRate * meanBody / 1e6 << " MB/s), getline with untyped details "
+              << legacyDecodeRate << " events/s" << std::endl;
+
+    bool ok = true;
+    if (encodeRate < legacyEncodeRate) {
+        std::cout << "FAILED: encode is slower than the ostringstream writer" << std::endl;
+        ok = false;
+    }
+    if (decodeRate < legacyDecodeRate) {
+        std::cout << "FAILED: decode is slower than the getline reader" << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+} // namespace
+
+int main() {
+    Fuzzer fuzzer;
+    size_t failures = 0;
+    size_t reported = 0;
+    for (size_t i = 0; i < ROUND_TRIPS; ++i) {
+        if (!fuzzer.roundTrip(reported)) ++failures;
+    }
+    std::cout << ROUND_TRIPS << " round trips, direct and through the server, " << failures << " failures" << std::endl;
+
+    bool ok = benchmark() && failures == 0;
+    std::cout << (ok ? "codec fuzz passed" : "codec fuzz FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../include/BodyCompression.h"
+#include "../include/EventGenerator.h"
+#include "../include/ReportCodec.h"
+#include "../include/StompProtocol.h"
+
+/**
+* Compresses report bodies of generated events at several description
+* lengths, decompresses them again and checks every one comes back as it was.
+* Prints bytes on the wire against plain bodies and the cost per frame of
+* compressing and decompressing; every size must get smaller on the wire.
+* Then feeds the same reports to StompProtocol as plain and as compressed
+* MESSAGE frames and checks both store the same reports, and checks that
+* damaged or oversized bodies are rejected rather than inflated.
+*/
+namespace {
+
+const size_t DESCRIPTION_LENGTHS[] = {40, 120, 400, 1500};
+const size_t EVENTS_PER_SIZE = 5000;
+const int PASSES = 5;
+const size_t DAMAGED_BODIES = 20000;
+
+// Results of the benchmarked work, kept so the compiler cannot drop it
+volatile size_t benchmarkSink = 0;
+
+std::vector<std::string> makeBodies(size_t descriptionLength, std::vector<Event>& events) {
+    EventGeneratorOptions options;
+    options.eventCount = EVENTS_PER_SIZE;
+    options.channel = "police";
+    options.meanDescriptionLength = descriptionLength;
+    EventGenerator generator(options);
+    events = generator.generate().events;
+    std::vector<std::string> bodies;
+    for (size_t i = 0; i < events.size(); ++i) {
+        bodies.emplace_back();
+        ReportCodec::encode("user" + std::to_string(i % 16), events[i], bodies.back());
+    }
+    return bodies;
+}
+
+// Seconds per body of the best of PASSES runs of work over bodies
+template <typename Work>
+double cost(const std::vector<std::string>& bodies, Work work) {
+    double best = 0;
+    size_t sink = 0;
+    for (int pass = 0; pass < PASSES; ++pass) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < bodies.size(); ++i) sink += work(i);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (pass == 0 || seconds < best) best = seconds;
+    }
+    benchmarkSink = sink;
+    return best / bodies.size();
+}
+
+// Compressed bodies, or the plain body where compress declined; counts how many were compressed
+std::vector<std::string> compressAll(const std::vector<std::string>& bodies, size_t& compressed) {
+    BodyCompressor compressor;
+    std::vector<std::string> wire;
+    compressed = 0;
+    for (const std::string& body : bodies) {
+        wire.emplace_back();
+        if (compressor.compress(body, wire.back())) {
+            ++compressed;
+        } else if (!wire.back().empty()) {
+            wire.back() = "";
+        } else {
+            wire.back() = body;
+        }
+    }
+    return wire;
+}
+
+// Whether compressing and decompressing bodies of this size gives them back and saves bytes
+bool checkSize(size_t descriptionLength) {
+    std::vector<Event> events;
+    std::vector<std::string> bodies = makeBodies(descriptionLength, events);
+    size_t compressed = 0;
+    std::vector<std::string> wire = compressAll(bodies, compressed);
+
+    BodyDecompressor decompressor;
+    size_t plainBytes = 0;
+    size_t wireBytes = 0;
+    size_t mismatches = 0;
+    std::string inflated;
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        plainBytes += bodies[i].size();
+        wireBytes += wire[i].size();
+        if (wire[i].empty()) {
+            ++mismatches; // compress appended to out and still returned false
+        } else if (wire[i] != bodies[i] && (!decompressor.decompress(wire[i], inflated) || inflated != bodies[i])) {
+            ++mismatches;
+        }
+    }
+
+    BodyCompressor compressor;
+    std::string out;
+    double compressCost = cost(bodies, [&](size_t i) {
+        out.clear();
+        compressor.compress(bodies[i], out);
+        return out.size();
+    });
+    double decompressCost = cost(bodies, [&](size_t i) {
+        if (wire[i] == bodies[i]) return size_t(0);
+        decompressor.decompress(wire[i], inflated);
+        return inflated.size();
+    });
+
+    std::cout << "  " << plainBytes / bodies.size() << " B bodies: " << wireBytes / bodies.size() << " B on the wire ("
+              << 100.0 * wireBytes / plainBytes << "%, " << compressed << " of " << bodies.size()
+              << " compressed), compress " << compressCost * 1e6 << " us, decompress " << decompressCost * 1e6
+              << " us per frame" << std::endl;
+    bool ok = true;
+    if (mismatches != 0) {
+        std::cout << "FAILED: " << mismatches << " bodies did not come back as they were" << std::endl;
+        ok = false;
+    }
+    if (wireBytes >= plainBytes) {
+        std::cout << "FAILED: compression does not make " << plainBytes / bodies.size() << " B bodies smaller" << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+std::vector<Report> storedReports(StompProtocol& protocol) {
+    std::vector<Report> reports;
+    for (const auto& [topic, user] : protocol.getReportKeys()) {
+        for (Report& report : protocol.getReports(topic, user)) reports.push_back(std::move(report));
+    }
+    return reports;
+}
+
+bool sameReport(const Report& a, const Report& b) {
+    return a.user == b.user && a.eventName == b.eventName && a.city == b.city && a.dateTime == b.dateTime &&
+           a.description == b.description && a.details == b.details;
+}
+
+// Whether StompProtocol stores the same reports from compressed MESSAGE frames as from plain ones
+bool checkProtocol() {
+    std::vector<Event> events;
+    std::vector<std::string> bodies = makeBodies(400, events);
+    size_t compressed = 0;
+    std::vector<std::string> wire = compressAll(bodies, compressed);
+
+    StompProtocol plain;
+    StompProtocol inflating;
+    int subscription = plain.joinTopic("/police");
+    inflating.joinTopic("/police");
+    std::vector<std::string> plainFrames;
+    std::vector<std::string> compressedFrames;
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        std::string headers = "MESSAGE\nsubscription:" + std::to_string(subscription) + "\nmessage-id:" + std::to_string(i) +
+                              "\ndestination:/police\n";
+        plainFrames.push_back(headers + "\n" + bodies[i]);
+        if (wire[i] == bodies[i]) compressedFrames.push_back(plainFrames.back());
+        else compressedFrames.push_back(headers + "content-encoding:" + BODY_CONTENT_ENCODING + "\n\n" + wire[i]);
+    }
+    plain.processFrames(plainFrames);
+    inflating.processFrames(compressedFrames);
+
+    std::vector<Report> expected = storedReports(plain);
+    std::vector<Report> got = storedReports(inflating);
+    size_t same = 0;
+    for (size_t i = 0; i < std::min(expected.size(), got.size()); ++i) {
+        if (sameReport(expected[i], got[i])) ++same;
+    }
+    std::cout << "StompProtocol: " << got.size() << " reports from " << compressed << " compressed frames, " << same
+              << " the same as from plain frames" << std::endl;
+    if (expected.size() != bodies.size() || got.size() != bodies.size() || same != bodies.size()) {
+        std::cout << "FAILED: compressed frames are not stored as plain ones" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Whether truncated, bit-flipped and oversized bodies are rejected or decoded without crashing
+bool checkDamaged() {
+    std::vector<Event> events;
+    std::vector<std::string> bodies = makeBodies(400, events);
+    size_t compressed = 0;
+    std::vector<std::string> wire = compressAll(bodies, compressed);
+
+    BodyDecompressor decompressor;
+    std::mt19937 rng(39);
+    std::string out;
+    size_t truncatedAccepted = 0;
+    size_t flippedAccepted = 0;
+    for (size_t i = 0; i < DAMAGED_BODIES; ++i) {
+        std::string encoded = wire[i % wire.size()];
+        if (encoded == bodies[i % bodies.size()] || encoded.size() < 8) continue;
+        if (i % 2 == 0) {
+            // Whole base64 quads only, so the cut lands in the deflate stream
+            encoded.resize(rng() % (encoded.size() / 4) * 4);
+            if (decompressor.decompress(encoded, out)) ++truncatedAccepted;
+        } else {
+            encoded[rng() % encoded.size()] = "AZaz09+/=!"[rng() % 10];
+            if (decompressor.decompress(encoded, out)) ++flippedAccepted;
+        }
+    }
+
+    // Highly repetitive, so well within a frame when compressed, but over the inflate limit
+    std::string huge(BodyDecompressor::MAX_BODY_SIZE + 1, 'a');
+    std::string bomb;
+    bool bombRejected = BodyCompressor().compress(huge, bomb) && !decompressor.decompress(bomb, out);
+
+    std::cout << DAMAGED_BODIES << " damaged bodies: " << truncatedAccepted << " truncated and " << flippedAccepted
+              << " altered ones decoded; " << bomb.size() << " B body of " << huge.size() << " B "
+              << (bombRejected ? "rejected" : "inflated") << std::endl;
+    bool ok = true;
+    if (truncatedAccepted != 0) {
+        std::cout << "FAILED: truncated bodies were decoded" << std::endl;
+        ok = false;
+    }
+    if (!bombRejected) {
+        std::cout << "FAILED: a body over BodyDecompressor::MAX_BODY_SIZE was inflated" << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+} // namespace
+
+int main() {
+    bool ok = true;
+    std::cout << "compression of generated report bodies:" << std::endl;
+    for (size_t descriptionLength : DESCRIPTION_LENGTHS) ok = checkSize(descriptionLength) && ok;
+    ok = checkProtocol() && ok;
+    ok = checkDamaged() && ok;
+    std::cout << (ok ? "compression benchmark passed" : "compression benchmark FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/DateFormatter.h"
+
+/**
+* Formats random timestamps between 1900 and 2100 with DateFormatter in zones
+* with and without daylight saving time, half-hour offsets and half-hour DST
+* shifts, and compares every one with localtime_r and strftime. Timestamps
+* around each zone's DST switches are included, where the cached offset is
+* not used. Then measures timestamps per second against the localtime and
+* put_time formatting StompClient::epochToDateTime used before, which the
+* formatter may not be slower than.
+*/
+namespace {
+
+const char* const ZONES[] = {"UTC", "Asia/Jerusalem", "America/New_York", "Europe/London", "America/St_Johns",
+                             "Australia/Lord_Howe", "Asia/Kolkata"};
+const size_t TIMESTAMPS_PER_ZONE = 300000;
+const long FIRST = -2208988800L; // 1900-01-01
+const long LAST = 4102444800L;   // 2100-01-01
+const size_t BENCHMARK_TIMESTAMPS = 200000;
+const int BENCHMARK_PASSES = 5;
+const size_t MAX_REPORTED = 5;
+
+// Results of the benchmarked work, kept so the compiler cannot drop it
+volatile size_t benchmarkSink = 0;
+
+std::string expected(long epochTime) {
+    std::time_t time = epochTime;
+    std::tm tm{};
+    localtime_r(&time, &tm);
+    char text[64];
+    return std::string(text, std::strftime(text, sizeof(text), "%d/%m/%Y %H:%M:%S", &tm));
+}
+
+// The formatting StompClient::epochToDateTime did before DateFormatter
+std::string legacyFormat(long epochTime) {
+    std::time_t time = epochTime;
+    std::tm* tmPtr = std::localtime(&time);
+    std::ostringstream oss;
+    oss << std::put_time(tmPtr, "%d/%m/%Y %H:%M:%S");
+    return oss.str();
+}
+
+long offset(long epochTime) {
+    std::time_t time = epochTime;
+    std::tm tm{};
+    localtime_r(&time, &tm);
+    return tm.tm_gmtoff;
+}
+
+// The instants in [FIRST, LAST) where the local offset changes, found by bisecting hourly steps
+std::vector<long> offsetChanges() {
+    std::vector<long> changes;
+    const long step = 3600;
+    for (long time = FIRST; time + step < LAST; time += step) {
+        if (offset(time) == offset(time + step)) continue;
+        long low = time;
+        long high = time + step;
+        while (high - low > 1) {
+            long middle = low + (high - low) / 2;
+            (offset(middle) == offset(low) ? low : high) = middle;
+        }
+        changes.push_back(high);
+    }
+    return changes;
+}
+
+// Formats TIMESTAMPS_PER_ZONE random timestamps and a few seconds around every offset change in
+// the current zone; returns how many differ from strftime
+size_t checkZone(const char* zone, size_t& checked, size_t& switches, size_t& reported) {
+    std::mt19937_64 rng(26);
+    std::uniform_int_distribution<long> anyTime(FIRST, LAST - 1);
+    std::vector<long> times;
+    for (size_t i = 0; i < TIMESTAMPS_PER_ZONE; ++i) times.push_back(anyTime(rng));
+    std::vector<long> changes = offsetChanges();
+    for (long change : changes) {
+        for (long delta : {-3601L, -3600L, -1800L, -1L, 0L, 1L, 1800L, 3599L, 3600L}) times.push_back(change + delta);
+    }
+    switches = changes.size();
+    checked = times.size();
+
+    DateFormatter formatter;
+    size_t failures = 0;
+    for (long time : times) {
+        std::string got = formatter.format(time);
+        std::string want = expected(time);
+        if (got == want) continue;
+        ++failures;
+        if (++reported <= MAX_REPORTED) {
+            std::cout << "FAILED: " << zone << " " << time << ": " << got << ", strftime " << want << std::endl;
+        }
+    }
+    return failures;
+}
+
+// Timestamps per second of the best of BENCHMARK_PASSES runs of work over times
+template <typename Work>
+double rate(const std::vector<long>& times, Work work) {
+    double best = 0;
+    size_t sink = 0;
+    for (int pass = 0; pass < BENCHMARK_PASSES; ++pass) {
+        auto start = std::chrono::steady_clock::now();
+        for (long time : times) sink += work(time);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = std::max(best, times.size() / seconds);
+    }
+    benchmarkSink = sink;
+    return best;
+}
+
+// Whether DateFormatter is at least as fast as put_time on report-like and on random timestamps
+bool benchmark() {
+    std::mt19937_64 rng(26);
+    // Reports of one summary: a few days of events, sorted as the summary writes them
+    std::vector<long> reportTimes;
+    std::uniform_int_distribution<long> fewDays(1718236800L, 1718236800L + 5 * 86400);
+    for (size_t i = 0; i < BENCHMARK_TIMESTAMPS; ++i) reportTimes.push_back(fewDays(rng));
+    std::sort(reportTimes.begin(), reportTimes.end());
+    std::vector<long> randomTimes;
+    std::uniform_int_distribution<long> anyTime(FIRST, LAST - 1);
+    for (size_t i = 0; i < BENCHMARK_TIMESTAMPS; ++i) randomTimes.push_back(anyTime(rng));
+
+    DateFormatter formatter;
+    char out[DateFormatter::LENGTH];
+    bool ok = true;
+    std::cout << "throughput in " << ZONES[1] << ":" << std::endl;
+    for (const auto& [name, times] : {std::make_pair("report", &reportTimes), std::make_pair("random", &randomTimes)}) {
+        double legacyRate = rate(*times, [](long time) { return legacyFormat(time).size(); });
+        double stringRate = rate(*times, [&formatter](long time) { return formatter.format(time).size(); });
+        double bufferRate = rate(*times, [&](long time) {
+            formatter.format(time, out);
+            return static_cast<size_t>(out[0]);
+        });
+        std::cout << "  " << name << " timestamps: " << bufferRate << "/s into a buffer, " << stringRate
+                  << "/s as strings, put_time " << legacyRate << "/s" << std::endl;
+        if (stringRate < legacyRate) {
+            std::cout << "FAILED: formatting " << name << " timestamps is slower than put_time" << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+} // namespace
+
+int main() {
+    size_t failures = 0;
+    size_t reported = 0;
+    for (const char* zone : ZONES) {
+        setenv("TZ", zone, 1);
+        tzset();
+        // The formatter caches offsets per thread and assumes the zone never changes; a fresh thread starts empty
+        size_t checked = 0;
+        size_t switches = 0;
+        std::thread worker([&] { failures += checkZone(zone, checked, switches, reported); });
+        worker.join();
+        std::cout << zone << ": " << checked << " timestamps around " << switches << " offset changes" << std::endl;
+    }
+    std::cout << failures << " failures" << std::endl;
+
+    setenv("TZ", ZONES[1], 1);
+    tzset();
+    bool ok = false;
+    std::thread worker([&ok] { ok = benchmark(); });
+    worker.join();
+    ok = ok && failures == 0;
+    std::cout << (ok ? "date formatter fuzz passed" : "date formatter fuzz FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
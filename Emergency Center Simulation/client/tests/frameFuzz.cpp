@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../include/EventGenerator.h"
+#include "../include/ReportCodec.h"
+#include "../include/StompProtocol.h"
+
+/**
+* Feeds StompProtocol::processFrames MESSAGE frames with valid and malformed
+* report bodies, randomly mutated ones and RECEIPT frames with bad ids, eagerly
+* and lazily parsed, and measures frames per second for each kind. Every valid
+* report must be stored, every malformed one rejected, nothing may crash, and
+* rejecting a frame may not cost much more than storing one.
+*/
+namespace {
+
+const size_t FRAMES_PER_KIND = 20000;
+const size_t BATCH = 256;
+const int PASSES = 5;
+// A rejected frame skips the store but still reads the body; it may be this much slower than a stored one
+const double MAX_REJECTION_SLOWDOWN = 2;
+
+struct Kind {
+    std::string name;
+    std::vector<std::string> frames;
+    bool stored;  // whether every frame's report is kept, or none
+    bool checked; // false for mutated frames, which may go either way
+    Kind(const char* name, bool stored, bool checked) : name(name), frames(), stored(stored), checked(checked) {}
+};
+
+std::vector<Kind> makeKinds(int subscription) {
+    EventGeneratorOptions options;
+    options.eventCount = FRAMES_PER_KIND;
+    options.channel = "police";
+    EventGenerator generator(options);
+    names_and_events data = generator.generate();
+
+    std::vector<Kind> kinds = {Kind("valid", true, true),     Kind("bad date", false, true),
+                               Kind("overflow", false, true), Kind("no user", false, true),
+                               Kind("mutated", false, false), Kind("receipt", false, true)};
+    std::mt19937 rng(49);
+    static const char* const receiptIds[] = {"abc", "99999999999999", "-", "12x", ""};
+    std::string body;
+    for (size_t i = 0; i < data.events.size(); ++i) {
+        body.clear();
+        ReportCodec::encode("user" + std::to_string(i % 8), data.events[i], body);
+        std::string head = "MESSAGE\nsubscription:" + std::to_string(subscription) + "\nmessage-id:" + std::to_string(i) +
+                           "\ndestination:/police\n\n";
+        size_t date = body.find("date time:") + 10;
+
+        kinds[0].frames.push_back(head + body);
+        kinds[1].frames.push_back(head + std::string(body).insert(date, "x"));
+        kinds[2].frames.push_back(head + std::string(body).insert(date, "99999999999999999999"));
+        kinds[3].frames.push_back(head + body.substr(body.find('\n') + 1));
+        std::string mutated = head + body;
+        for (int k = 0; k < 4; ++k) mutated[rng() % mutated.size()] = static_cast<char>(rng() % 256);
+        kinds[4].frames.push_back(std::move(mutated));
+        kinds[5].frames.push_back(std::string("RECEIPT\nreceipt-id:") + receiptIds[i % 5] + "\n\n");
+    }
+    return kinds;
+}
+
+// Frames per second of the best pass; stored is how many reports the last pass kept
+double run(const Kind& kind, bool lazy, size_t& stored) {
+    double best = 0;
+    std::vector<std::string> batch;
+    for (int pass = 0; pass < PASSES; ++pass) {
+        StompProtocol protocol;
+        protocol.setLazyParsing(lazy);
+        protocol.joinTopic("/police");
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < kind.frames.size(); i += BATCH) {
+            batch.assign(kind.frames.begin() + i, kind.frames.begin() + std::min(kind.frames.size(), i + BATCH));
+            protocol.processFrames(batch);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = std::max(best, kind.frames.size() / seconds);
+        stored = 0;
+        for (const auto& [topic, usage] : protocol.getMemoryUsage()) stored += usage.reports;
+    }
+    return best;
+}
+
+bool fuzz(const std::vector<Kind>& kinds, bool lazy) {
+    bool ok = true;
+    double validRate = 0;
+    std::cout << (lazy ? "lazy" : "eager") << " parsing:" << std::endl;
+    for (const Kind& kind : kinds) {
+        size_t stored = 0;
+        // Every malformed frame is reported on std::cerr; keep the output to the results
+        std::cerr.setstate(std::ios::failbit);
+        double rate = run(kind, lazy, stored);
+        std::cerr.clear();
+        if (validRate == 0) validRate = rate;
+
+        std::cout << "  " << kind.name << ": " << rate << " frames/s, " << stored << " stored" << std::endl;
+        if (kind.checked && stored != (kind.stored ? kind.frames.size() : 0)) {
+            std::cout << "FAILED: expected " << (kind.stored ? kind.frames.size() : 0) << " stored" << std::endl;
+            ok = false;
+        }
+        if (rate * MAX_REJECTION_SLOWDOWN < validRate) {
+            std::cout << "FAILED: more than " << MAX_REJECTION_SLOWDOWN << " times slower than valid frames" << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+} // namespace
+
+int main() {
+    // A fresh protocol hands out the same first subscription id every time
+    std::vector<Kind> kinds = makeKinds(StompProtocol().joinTopic("/police"));
+    bool ok = fuzz(kinds, false);
+    ok = fuzz(kinds, true) && ok;
+    std::cout << (ok ? "frame fuzz passed" : "frame fuzz FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../include/EventGenerator.h"
+#include "../include/ReportCodec.h"
+#include "../include/StompProtocol.h"
+
+/**
+* Measures MESSAGE ingest through StompProtocol::processFrames at the batch
+* sizes the reader hands it: 1 when frames trickle in, and up to
+* MAX_RECEIVE_BATCH (256) when it drains a burst. Prints frames per second and
+* the cost per frame, eagerly and lazily parsed, next to the cost of only
+* copying the frames into an arena, which lazy ingest tries to approach.
+* Checks that every report was stored and that lazy ingest is faster.
+*
+* Reports are ingested once in date time order, the usual case, and once in
+* the generator's random order, where every report lands in the middle of the
+* store's time index and small batches pay for moving its tail.
+*/
+namespace {
+
+const size_t FRAMES = 50000;
+const size_t BATCH_SIZES[] = {1, 16, 256};
+const int PASSES = 5;
+// How much faster lazy ingest must be than eager at the largest batch size
+const double MIN_LAZY_SPEEDUP = 1.5;
+
+std::vector<std::string> makeFrames(int subscription, bool inTimeOrder) {
+    EventGeneratorOptions options;
+    options.eventCount = FRAMES;
+    options.channel = "police";
+    EventGenerator generator(options);
+    names_and_events data = generator.generate();
+    if (inTimeOrder) {
+        std::stable_sort(data.events.begin(), data.events.end(),
+                         [](const Event& a, const Event& b) { return a.get_date_time() < b.get_date_time(); });
+    }
+
+    std::vector<std::string> frames;
+    frames.reserve(data.events.size());
+    for (size_t i = 0; i < data.events.size(); ++i) {
+        std::string frame = "MESSAGE\nsubscription:" + std::to_string(subscription) + "\nmessage-id:" + std::to_string(i) +
+                            "\ndestination:/police\n\n";
+        ReportCodec::encode("user" + std::to_string(i % 16), data.events[i], frame);
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
+
+// Seconds per frame of the best pass; stored is how many reports the last pass kept
+double ingest(const std::vector<std::vector<std::string>>& batches, size_t frames, bool lazy, size_t& stored) {
+    double best = 0;
+    for (int pass = 0; pass < PASSES; ++pass) {
+        StompProtocol protocol;
+        protocol.setLazyParsing(lazy);
+        protocol.joinTopic("/police");
+        auto start = std::chrono::steady_clock::now();
+        for (const std::vector<std::string>& batch : batches) {
+            protocol.processFrames(batch);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (pass == 0 || seconds < best) best = seconds;
+        stored = 0;
+        for (const auto& [topic, usage] : protocol.getMemoryUsage()) stored += usage.reports;
+    }
+    return best / frames;
+}
+
+// Seconds per frame of appending every frame to one buffer, the floor for storing them raw
+double copy(const std::vector<std::string>& frames) {
+    double best = 0;
+    std::string arena;
+    for (int pass = 0; pass < PASSES; ++pass) {
+        auto start = std::chrono::steady_clock::now();
+        arena.clear();
+        for (const std::string& frame : frames) arena.append(frame);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (pass == 0 || seconds < best) best = seconds;
+    }
+    return best / frames.size();
+}
+
+void print(const char* mode, double cost) {
+    std::cout << ", " << mode << " " << 1 / cost << " frames/s (" << cost * 1e9 << " ns per frame)";
+}
+
+} // namespace
+
+int main() {
+    // A fresh protocol hands out the same first subscription id every time
+    int subscription = StompProtocol().joinTopic("/police");
+    bool ok = true;
+    for (bool inTimeOrder : {true, false}) {
+        std::vector<std::string> frames = makeFrames(subscription, inTimeOrder);
+        std::cout << (inTimeOrder ? "in date time order:" : "in random order:") << std::endl;
+        double eagerCost = 0;
+        double lazyCost = 0;
+        for (size_t batchSize : BATCH_SIZES) {
+            std::vector<std::vector<std::string>> batches;
+            for (size_t i = 0; i < frames.size(); i += batchSize) {
+                batches.emplace_back(frames.begin() + i, frames.begin() + std::min(frames.size(), i + batchSize));
+            }
+            size_t eagerStored = 0;
+            size_t lazyStored = 0;
+            eagerCost = ingest(batches, frames.size(), false, eagerStored);
+            lazyCost = ingest(batches, frames.size(), true, lazyStored);
+            std::cout << "  batch " << batchSize;
+            print("eager", eagerCost);
+            print("lazy", lazyCost);
+            std::cout << std::endl;
+            if (eagerStored != frames.size() || lazyStored != frames.size()) {
+                std::cout << "FAILED: expected " << frames.size() << " stored, got " << eagerStored << " eager and "
+                          << lazyStored << " lazy" << std::endl;
+                ok = false;
+            }
+        }
+        std::cout << "  copying the frames alone: " << copy(frames) * 1e9 << " ns per frame" << std::endl;
+        if (eagerCost < MIN_LAZY_SPEEDUP * lazyCost) {
+            std::cout << "FAILED: lazy ingest is only " << eagerCost / lazyCost << " times as fast as eager" << std::endl;
+            ok = false;
+        }
+    }
+    std::cout << (ok ? "ingest benchmark passed" : "ingest benchmark FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
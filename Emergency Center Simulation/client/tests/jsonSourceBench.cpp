@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../include/EventGenerator.h"
+#include "../include/EventSource.h"
+
+/**
+* Loads a generated events file and a set of hand-written ones with both
+* EventSource backends and checks that they give back the same events, field
+* by field: escapes, \u surrogate pairs, numbers of every kind, members in
+* any order and channel_name after the events. Missing required fields and
+* malformed files must raise runtime_error. Then measures events per second
+* for both backends on the generated file; the fast backend may not be slower.
+*/
+namespace {
+
+const size_t EVENT_COUNT = 50000;
+const int LOAD_PASSES = 3;
+const char* const GENERATED_PATH = "bin/jsonSourceBench.json";
+const char* const CASE_PATH = "bin/jsonSourceBench.case.json";
+
+// A hand-written file, and what some of its fields must load as
+struct Case {
+    const char* name;
+    const char* json;
+    const char* city;
+    const char* description;
+};
+
+const Case CASES[] = {
+    {"escapes",
+     R"({"channel_name": "police", "events": [{"event_name": "e", "city": "a \"quoted\" \\ \/ city",
+         "date_time": 1, "description": "line\nbreak\ttab\r\b\f", "general_information": {}}]})",
+     "a \"quoted\" \\ / city", "line\nbreak\ttab\r\b\f"},
+    {"unicode",
+     R"({"channel_name": "fire", "events": [{"event_name": "e", "city": "caf\u00e9 \u20AC",
+         "date_time": 2, "description": "\ud83d\ude91 ambulance", "general_information": {"k\u00e9y": "v"}}]})",
+     "caf\xc3\xa9 \xe2\x82\xac", "\xf0\x9f\x9a\x91 ambulance"},
+    {"numbers",
+     R"({"channel_name": "police", "events": [{"event_name": "e", "city": "c", "date_time": 1718236800,
+         "description": "d", "general_information": {"int": -42, "float": 1.5, "exponent": -2e3,
+         "big": 12345678901234567890, "flag": true, "off": false, "none": null, "list": [1, 2, {"x": null}],
+         "text": "12"}}]})",
+     "c", "d"},
+    {"channel after events",
+     R"({"events": [{"general_information": {"active": true}, "description": "d", "date_time": 3,
+         "city": "c", "event_name": "e"}, {"event_name": "f", "city": "c2", "date_time": 4, "description": "",
+         "general_information": {}}], "channel_name": "medical"})",
+     "c", "d"},
+    {"unknown members",
+     R"({"version": 2, "channel_name": "police", "meta": {"tags": ["a", {"b": [true, null]}]}, "events": [
+         {"event_name": "e", "extra": [1, [2, 3]], "city": "c", "date_time": 5, "description": "d",
+         "general_information": {}, "note": "skipped"}]})",
+     "c", "d"},
+};
+
+// Files every backend must reject with runtime_error
+const char* const MALFORMED[] = {
+    R"({"channel_name": "police", "events": [{"event_name": "e", "city": "c", "date_time": 1)",
+    R"({"channel_name": "police", "events": [{"event_name": "e", "city": "c" "date_time": 1}]})",
+    R"({"channel_name": "police", "events": [{"event_name": "unterminated}]})",
+    R"({"channel_name": "police", "events": []} trailing)",
+    "",
+};
+
+// Files only the fast backend checks; nlohmann's operator[] on a const event does not
+const char* const MISSING_FIELD[] = {
+    R"({"channel_name": "police", "events": [{"city": "c", "date_time": 1, "description": "d", "general_information": {}}]})",
+    R"({"channel_name": "police", "events": [{"event_name": "e", "date_time": 1, "description": "d", "general_information": {}}]})",
+    R"({"channel_name": "police", "events": [{"event_name": "e", "city": "c", "description": "d", "general_information": {}}]})",
+    R"({"channel_name": "police", "events": [{"event_name": "e", "city": "c", "date_time": 1, "general_information": {}}]})",
+    R"({"events": []})",
+};
+
+// The first event that differs, or -1 if a and b hold the same events
+long firstDifference(const names_and_events& a, const names_and_events& b) {
+    if (a.channel_name != b.channel_name) return 0;
+    size_t count = std::min(a.events.size(), b.events.size());
+    for (size_t i = 0; i < count; ++i) {
+        const Event& x = a.events[i];
+        const Event& y = b.events[i];
+        if (x.get_channel_name() != y.get_channel_name() || x.get_name() != y.get_name() || x.get_city() != y.get_city() ||
+            x.get_date_time() != y.get_date_time() || x.get_description() != y.get_description() ||
+            x.get_general_information() != y.get_general_information()) {
+            return static_cast<long>(i);
+        }
+    }
+    return a.events.size() == b.events.size() ? -1 : static_cast<long>(count);
+}
+
+void writeFile(const char* path, const std::string& content) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+}
+
+bool rejects(EventSource& source, const char* path) {
+    try {
+        source.load(path);
+        return false;
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+}
+
+// Whether both backends load every case alike and as expected, and reject the bad files
+bool checkCases(EventSource& nlohmann, EventSource& fast) {
+    bool ok = true;
+    for (const Case& test : CASES) {
+        writeFile(CASE_PATH, test.json);
+        names_and_events expected = nlohmann.load(CASE_PATH);
+        names_and_events got = fast.load(CASE_PATH);
+        long difference = firstDifference(expected, got);
+        if (difference >= 0) {
+            std::cout << "FAILED: " << test.name << ": the backends differ at event " << difference << std::endl;
+            ok = false;
+        } else if (got.events.empty() || got.events[0].get_city() != test.city ||
+                   got.events[0].get_description() != test.description) {
+            std::cout << "FAILED: " << test.name << ": city or description not decoded" << std::endl;
+            ok = false;
+        }
+    }
+    for (const char* json : MALFORMED) {
+        writeFile(CASE_PATH, json);
+        for (EventSource* source : {&nlohmann, &fast}) {
+            if (!rejects(*source, CASE_PATH)) {
+                std::cout << "FAILED: " << source->name() << " loaded malformed file:\n" << json << std::endl;
+                ok = false;
+            }
+        }
+    }
+    for (const char* json : MISSING_FIELD) {
+        writeFile(CASE_PATH, json);
+        if (!rejects(fast, CASE_PATH)) {
+            std::cout << "FAILED: fast loaded a file missing a field:\n" << json << std::endl;
+            ok = false;
+        }
+    }
+    std::remove(CASE_PATH);
+    for (EventSource* source : {&nlohmann, &fast}) {
+        if (!rejects(*source, CASE_PATH)) {
+            std::cout << "FAILED: " << source->name() << " loaded a missing file" << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// Events per second of the fastest of LOAD_PASSES loads; data is what the last one loaded
+double rate(EventSource& source, names_and_events& data) {
+    double best = 0;
+    for (int pass = 0; pass < LOAD_PASSES; ++pass) {
+        auto start = std::chrono::steady_clock::now();
+        data = source.load(GENERATED_PATH);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = std::max(best, data.events.size() / seconds);
+    }
+    return best;
+}
+
+} // namespace
+
+int main() {
+    std::unique_ptr<EventSource> nlohmann = EventSource::create("nlohmann");
+    std::unique_ptr<EventSource> fast = EventSource::create("fast");
+    bool ok = checkCases(*nlohmann, *fast);
+    std::cout << sizeof(CASES) / sizeof(*CASES) << " hand-written files, " << sizeof(MALFORMED) / sizeof(*MALFORMED)
+              << " malformed, " << sizeof(MISSING_FIELD) / sizeof(*MISSING_FIELD) << " missing a field" << std::endl;
+
+    EventGeneratorOptions options;
+    options.eventCount = EVENT_COUNT;
+    EventGenerator generator(options);
+    names_and_events generated = generator.generate();
+    if (!EventGenerator::writeJson(generated, GENERATED_PATH)) {
+        std::cerr << "Cannot write the test file under bin/" << std::endl;
+        return 1;
+    }
+    names_and_events fromNlohmann{"", {}};
+    names_and_events fromFast{"", {}};
+    double nlohmannRate = rate(*nlohmann, fromNlohmann);
+    double fastRate = rate(*fast, fromFast);
+    std::remove(GENERATED_PATH);
+    for (const auto& [name, data] : {std::make_pair("nlohmann", &fromNlohmann), std::make_pair("fast", &fromFast)}) {
+        long difference = firstDifference(generated, *data);
+        if (difference >= 0) {
+            std::cout << "FAILED: " << name << " loads the generated file differently from event " << difference << std::endl;
+            ok = false;
+        }
+    }
+
+    std::cout << EVENT_COUNT << " generated events: nlohmann " << nlohmannRate << " events/s, fast " << fastRate
+              << " events/s" << std::endl;
+    if (fastRate < nlohmannRate) {
+        std::cout << "FAILED: the fast backend is slower than nlohmann" << std::endl;
+        ok = false;
+    }
+    std::cout << (ok ? "JSON source benchmark passed" : "JSON source benchmark FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
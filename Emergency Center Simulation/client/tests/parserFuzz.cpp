@@ -0,0 +1,379 @@
+#include <charconv>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#include "../include/event.h"
+
+/**
+* Fuzzes Event(const std::string& frame_body), which decodes with ReportCodec,
+* against the stringstream parser it replaced on unrestricted input: random
+* bytes, random sequences of the tokens a body is made of, and well-formed
+* bodies with random bytes overwritten, inserted or deleted.
+*
+* The decoder differs from the old parser on purpose in the ways listed in
+* Divergence. referenceParse is the old parser with any of them applied: with
+* none it is the old parser as it was, with all of them Event must read every
+* input exactly as it does, or throw the same exception type. Each divergence
+* is also asserted by name on explicit bodies, with what each parser reads
+* from them, and must be hit by some of the random inputs. Details are
+* compared by their text; Event types them, but they print as they were read.
+*/
+namespace {
+
+enum Divergence : unsigned {
+    // A value is everything after the first ':'; the old parser dropped it if the line had another one
+    VALUES_KEEP_COLONS = 1,
+    // After "general information" every keyed line but the description is a detail under its whole
+    // key, and nothing else; the old parser dropped the key's first character, stored the description
+    // line as well, read header fields there as header fields too, and threw on an empty key
+    DETAILS_KEYED_IN_FULL = 2,
+    // The description is the value on its line followed by every later line trimmed, empty ones dropped,
+    // joined with spaces; the old parser kept the later lines raw and dropped the value
+    DESCRIPTION_JOINED = 4,
+    // "channel name" is not read; the channel travels in the destination header
+    NO_CHANNEL = 8,
+    // The date time must be a whole number that fits an int, else runtime_error; stoi read a prefix,
+    // took '+', and threw invalid_argument or out_of_range
+    STRICT_DATE = 16,
+    // A body without a user throws runtime_error
+    USER_REQUIRED = 32,
+    ALL_DIVERGENCES = 63
+};
+
+const std::pair<Divergence, const char*> DIVERGENCES[] = {
+    {VALUES_KEEP_COLONS, "values keep colons"}, {DETAILS_KEYED_IN_FULL, "details keyed in full"},
+    {DESCRIPTION_JOINED, "description joined"}, {NO_CHANNEL, "no channel"},
+    {STRICT_DATE, "strict date"},               {USER_REQUIRED, "user required"}};
+
+struct Parsed {
+    std::string error; // the exception type thrown, empty if none
+    std::string user;
+    std::string channel;
+    std::string city;
+    std::string name;
+    int dateTime;
+    std::string description;
+    std::map<std::string, std::string> details;
+    Parsed() : error(), user(), channel(), city(), name(), dateTime(0), description(), details() {}
+
+    bool operator==(const Parsed& other) const {
+        return error == other.error && user == other.user && channel == other.channel && city == other.city &&
+               name == other.name && dateTime == other.dateTime && description == other.description &&
+               details == other.details;
+    }
+};
+
+std::string trimmed(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t\n\r");
+    if (first == std::string::npos) return "";
+    return text.substr(first, text.find_last_not_of(" \t\n\r") - first + 1);
+}
+
+void legacySplit(const std::string& input, char delimiter, std::vector<std::string>& output) {
+    std::stringstream ss(input);
+    std::string item;
+    while (std::getline(ss, item, delimiter)) {
+        item.erase(0, item.find_first_not_of(" \t\n\r"));
+        item.erase(item.find_last_not_of(" \t\n\r") + 1);
+        output.push_back(item);
+    }
+}
+
+// The body parser Event(const std::string&) used before ReportCodec, with the given divergences applied
+void referenceParse(const std::string& frame_body, unsigned divergences, Parsed& event) {
+    auto has = [divergences](Divergence divergence) { return (divergences & divergence) != 0; };
+    std::stringstream ss(frame_body);
+    std::string line;
+    std::string eventDescription;
+    bool inGeneralInformation = false;
+    long dateTime = 0;
+    while (std::getline(ss, line, '\n')) {
+        std::vector<std::string> lineArgs;
+        if (line.find(':') != std::string::npos) {
+            legacySplit(line, ':', lineArgs);
+            std::string key = lineArgs.at(0);
+            std::string val;
+            if (has(VALUES_KEEP_COLONS)) {
+                val = trimmed(line.substr(line.find(':') + 1));
+            } else if (lineArgs.size() == 2) {
+                val = lineArgs.at(1);
+            }
+            if (has(DETAILS_KEYED_IN_FULL) && inGeneralInformation && key != "description") {
+                event.details[key] = val;
+                continue;
+            }
+            if (key == "user") {
+                event.user = val;
+            }
+            if (key == "channel name" && !has(NO_CHANNEL)) {
+                event.channel = val;
+            }
+            if (key == "city") {
+                event.city = val;
+            } else if (key == "event name") {
+                event.name = val;
+            } else if (key == "date time") {
+                if (has(STRICT_DATE)) {
+                    auto result = std::from_chars(val.data(), val.data() + val.size(), dateTime);
+                    if (result.ec != std::errc() || result.ptr != val.data() + val.size()) throw std::runtime_error("date time");
+                } else {
+                    event.dateTime = std::stoi(val);
+                }
+            } else if (key == "general information") {
+                inGeneralInformation = true;
+                continue;
+            } else if (key == "description") {
+                if (has(DESCRIPTION_JOINED)) {
+                    eventDescription = val;
+                    while (std::getline(ss, line, '\n')) {
+                        line = trimmed(line);
+                        if (line.empty()) continue;
+                        if (!eventDescription.empty()) eventDescription += ' ';
+                        eventDescription += line;
+                    }
+                } else {
+                    while (std::getline(ss, line, '\n')) {
+                        eventDescription += line + "\n";
+                    }
+                }
+                event.description = eventDescription;
+            }
+
+            if (inGeneralInformation && !has(DETAILS_KEYED_IN_FULL)) {
+                event.details[key.substr(1)] = val;
+            }
+        }
+    }
+    if (has(STRICT_DATE)) {
+        // Only the last date time counts, as in decode
+        if (dateTime < std::numeric_limits<int>::min() || dateTime > std::numeric_limits<int>::max()) {
+            throw std::runtime_error("date time");
+        }
+        event.dateTime = static_cast<int>(dateTime);
+    }
+    if (has(USER_REQUIRED) && event.user.empty()) throw std::runtime_error("user");
+}
+
+Parsed runReference(const std::string& body, unsigned divergences) {
+    Parsed parsed;
+    try {
+        referenceParse(body, divergences, parsed);
+    } catch (const std::exception& e) {
+        parsed = Parsed();
+        parsed.error = typeid(e).name();
+    }
+    return parsed;
+}
+
+Parsed runEvent(const std::string& body) {
+    Parsed parsed;
+    try {
+        Event event(body);
+        parsed.user = event.getEventOwnerUser();
+        parsed.channel = event.get_channel_name();
+        parsed.city = event.get_city();
+        parsed.name = event.get_name();
+        parsed.dateTime = event.get_date_time();
+        parsed.description = event.get_description();
+        for (const auto& [key, value] : event.get_general_information()) parsed.details[key] = value.toString();
+    } catch (const std::exception& e) {
+        parsed.error = typeid(e).name();
+    }
+    return parsed;
+}
+
+std::string printable(const std::string& text) {
+    static const char hex[] = "0123456789abcdef";
+    std::string out;
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '\n') out += "\\n";
+        else if (c == '\r') out += "\\r";
+        else if (c == '\t') out += "\\t";
+        else if (byte < 0x20 || byte >= 0x7f) out += std::string("\\x") + hex[byte >> 4] + hex[byte & 15];
+        else out += c;
+    }
+    return out;
+}
+
+// The value parsed for a detail key, or "<none>"
+std::string detail(const Parsed& parsed, const std::string& key) {
+    auto it = parsed.details.find(key);
+    return it == parsed.details.end() ? "<none>" : it->second;
+}
+
+// One body, one field read from it, and what the old parser and Event read there
+struct Case {
+    const char* what;
+    std::string body;
+    std::string (*read)(const Parsed&);
+    std::string legacy;
+    std::string decoded;
+};
+
+std::string readError(const Parsed& parsed) { return parsed.error; }
+std::string readUser(const Parsed& parsed) { return parsed.user; }
+std::string readChannel(const Parsed& parsed) { return parsed.channel; }
+std::string readCity(const Parsed& parsed) { return parsed.city; }
+std::string readDateTime(const Parsed& parsed) { return std::to_string(parsed.dateTime); }
+std::string readDescription(const Parsed& parsed) { return parsed.description; }
+std::string readActive(const Parsed& parsed) { return detail(parsed, "active") + "/" + detail(parsed, "ctive"); }
+std::string readEmptyKey(const Parsed& parsed) { return detail(parsed, ""); }
+std::string readEscription(const Parsed& parsed) { return detail(parsed, "escription"); }
+
+bool checkCases() {
+    const std::string runtimeError = typeid(std::runtime_error).name();
+    const std::string outOfRange = typeid(std::out_of_range).name();
+    const std::string invalidArgument = typeid(std::invalid_argument).name();
+    const Case cases[] = {
+        // Rules both parsers follow
+        {"the key and value are trimmed of \\r too", "user:u\n \tcity \r:\t Haifa \r\n", readCity, "Haifa", "Haifa"},
+        {"a later header line wins", "user:u\ncity:a\ncity:b\n", readCity, "b", "b"},
+        {"keys match exactly", "user:u\nCity:a\n", readCity, "", ""},
+        // values keep colons
+        {"a value with a second colon", "user:u\ncity:Tel Aviv: north\n", readCity, "", "Tel Aviv: north"},
+        {"a value with a trailing colon", "user:u\ncity:Haifa:\n", readCity, "Haifa", "Haifa:"},
+        // details keyed in full
+        {"a detail key", "user:u\ngeneral information:\n  active:true\n", readActive, "<none>/true", "true/<none>"},
+        {"a header field among the details", "user:u\ngeneral information:\n  city:Haifa\n", readCity, "Haifa", ""},
+        {"the user among the details", "user:u\ngeneral information:\n  user:v\n", readUser, "v", "u"},
+        {"an empty detail key", "user:u\ngeneral information:\n  :x\n", readError, outOfRange, ""},
+        {"an empty detail key's value", "user:u\ngeneral information:\n  :x\n", readEmptyKey, "<none>", "x"},
+        {"the description line among the details", "user:u\ngeneral information:\ndescription:\nx\n", readEscription, "",
+         "<none>"},
+        // description joined
+        {"description lines", "user:u\ndescription:\n  a\n\nb: c", readDescription, "  a\n\nb: c\n", "a b: c"},
+        {"a value on the description line", "user:u\ndescription: first\nsecond\n", readDescription, "second\n",
+         "first second"},
+        // no channel
+        {"the channel name", "user:u\nchannel name:police\n", readChannel, "police", ""},
+        // strict date
+        {"a date time with trailing text", "user:u\ndate time: 12ab\n", readDateTime, "12", "0"},
+        {"a date time with trailing text", "user:u\ndate time: 12ab\n", readError, "", runtimeError},
+        {"a date time with a '+'", "user:u\ndate time:+3\n", readError, "", runtimeError},
+        {"a date time that is not a number", "user:u\ndate time:soon\n", readError, invalidArgument, runtimeError},
+        {"a date time beyond an int", "user:u\ndate time:99999999999\n", readError, outOfRange, runtimeError},
+        {"a bad date time followed by a good one", "user:u\ndate time:99999999999\ndate time:7\n", readError,
+         outOfRange, ""},
+        // user required
+        {"a body without a user", "city:Haifa\n", readError, "", runtimeError},
+        {"a body with an empty user", "user: \t\ncity:Haifa\n", readError, "", runtimeError},
+    };
+
+    bool ok = true;
+    for (const Case& c : cases) {
+        std::string legacy = c.read(runReference(c.body, 0));
+        std::string decoded = c.read(runEvent(c.body));
+        if (legacy != c.legacy || decoded != c.decoded) {
+            std::cout << "FAILED: " << c.what << ": \"" << printable(c.body) << "\" reads \"" << printable(legacy)
+                      << "\" before and \"" << printable(decoded) << "\" now" << std::endl;
+            ok = false;
+        }
+    }
+
+    // Details come back typed from their canonical spelling only
+    Event typed("user:u\ngeneral information:\n  active:true\n  units:3\n  code:007\n  ratio:1.50\n");
+    const std::map<std::string, DetailValue>& details = typed.get_general_information();
+    if (details.at("active").kind() != DetailValue::Bool || details.at("units").kind() != DetailValue::Int ||
+        details.at("code").kind() != DetailValue::String || details.at("ratio").toString() != "1.50") {
+        std::cout << "FAILED: details are not typed from their canonical spelling" << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+class InputGenerator {
+private:
+    std::mt19937 rng;
+
+    size_t below(size_t n) { return rng() % n; }
+
+public:
+    InputGenerator() : rng(20240613) {}
+
+    std::string bytes() {
+        std::string bytes;
+        for (size_t i = below(200); i > 0; --i) bytes += static_cast<char>(rng() % 256);
+        return bytes;
+    }
+
+    std::string tokens() {
+        static const char* const pieces[] = {
+            "user",   "channel name", "city",  "event name", "date time", "general information", "description",
+            ":",      ":",            "\n",    "\n",         "\r",        " ",                   "\t",
+            "x",      "ab",           "12",    "-7",         "+3",        "99999999999",         "\xc3\xa9",
+            "\0"};
+        std::string text;
+        for (size_t i = below(60); i > 0; --i) {
+            size_t piece = below(sizeof(pieces) / sizeof(*pieces));
+            if (pieces[piece][0] == '\0') text += '\0';
+            else text += pieces[piece];
+        }
+        return text;
+    }
+
+    std::string mutated() {
+        std::string body = "user:u" + std::to_string(below(100)) + "\nchannel name:police\ncity:c\nevent name:fire\n" +
+                           "date time:" + std::to_string(static_cast<int>(rng())) +
+                           "\ngeneral information:\n        active:true\n        forces:false\ndescription:\nsmoke\n";
+        for (size_t i = 1 + below(4); i > 0; --i) {
+            size_t at = below(body.size() + 1);
+            switch (below(3)) {
+                case 0:
+                    if (at < body.size()) body[at] = static_cast<char>(rng() % 256);
+                    break;
+                case 1: body.insert(at, 1, "\n:: \r\t"[below(6)]); break;
+                default: body.erase(at, below(8)); break;
+            }
+        }
+        return body;
+    }
+};
+
+const size_t INPUTS_PER_KIND = 300000;
+// Every this many inputs, count which divergences change what is read
+const size_t DIVERGENCE_SAMPLE = 16;
+const size_t MAX_REPORTED = 5;
+
+} // namespace
+
+int main() {
+    bool ok = checkCases();
+
+    InputGenerator generator;
+    size_t failures = 0;
+    size_t unchanged = 0;
+    std::map<Divergence, size_t> hits;
+    for (size_t i = 0; i < 3 * INPUTS_PER_KIND; ++i) {
+        std::string body = i % 3 == 0 ? generator.bytes() : i % 3 == 1 ? generator.tokens() : generator.mutated();
+        Parsed decoded = runEvent(body);
+        Parsed expected = runReference(body, ALL_DIVERGENCES);
+        if (!(decoded == expected) && ++failures <= MAX_REPORTED) {
+            std::cout << "FAILED: Event and the reference disagree on \"" << printable(body) << "\"" << std::endl;
+        }
+        if (decoded == runReference(body, 0)) ++unchanged;
+        if (i % DIVERGENCE_SAMPLE == 0) {
+            for (const auto& [divergence, name] : DIVERGENCES) {
+                if (!(runReference(body, ALL_DIVERGENCES & ~divergence) == expected)) ++hits[divergence];
+            }
+        }
+    }
+
+    std::cout << 3 * INPUTS_PER_KIND << " random, token and mutated bodies, " << unchanged
+              << " read as the old parser did, " << failures << " failures" << std::endl;
+    std::cout << "divergences hit in every " << DIVERGENCE_SAMPLE << "th body:";
+    for (const auto& [divergence, name] : DIVERGENCES) {
+        std::cout << " " << name << " " << hits[divergence];
+        if (hits[divergence] == 0) ok = false;
+    }
+    std::cout << std::endl;
+    ok = ok && failures == 0;
+    std::cout << (ok ? "parser fuzz passed" : "parser fuzz FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "../include/EventGenerator.h"
+#include "../include/ReportCodec.h"
+#include "../include/StompProtocol.h"
+
+/**
+* Streams MESSAGE frames through StompProtocol::processFrames for as long as a
+* shift's worth of traffic, with a bounded retention policy on every channel,
+* and checks that the stores and the resident set stay flat.
+*/
+namespace {
+
+const size_t DISTINCT_FRAMES = 20000;
+const size_t BATCH = 256;
+const int ROUNDS = 40;
+const int WARM_UP_ROUNDS = 5;
+const long MAX_GROWTH_KB = 16 * 1024; // allocator slack after the warm-up
+const size_t POLICE_MAX_REPORTS = 2000;
+const size_t FIRE_MAX_BYTES = size_t(2) << 20;
+
+long residentKb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmRSS:") == 0) return std::stol(line.substr(6));
+    }
+    return 0;
+}
+
+std::vector<std::string> makeFrames(int policeId, int fireId) {
+    EventGeneratorOptions options;
+    options.eventCount = DISTINCT_FRAMES;
+    options.channel = "police";
+    EventGenerator generator(options);
+    names_and_events data = generator.generate();
+
+    std::vector<std::string> frames;
+    frames.reserve(data.events.size());
+    for (size_t i = 0; i < data.events.size(); ++i) {
+        bool police = i % 2 == 0;
+        std::string frame = "MESSAGE\nsubscription:" + std::to_string(police ? policeId : fireId) + "\nmessage-id:" +
+                            std::to_string(i) + "\ndestination:" + (police ? "/police" : "/fire") + "\n\n";
+        ReportCodec::encode("user" + std::to_string(i % 16), data.events[i], frame);
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
+
+bool soak(bool lazy) {
+    StompProtocol protocol;
+    protocol.setLazyParsing(lazy);
+    int policeId = protocol.joinTopic("/police");
+    int fireId = protocol.joinTopic("/fire");
+    RetentionPolicy police;
+    police.maxReports = POLICE_MAX_REPORTS;
+    protocol.setRetention("/police", police);
+    RetentionPolicy fire;
+    fire.maxBytes = FIRE_MAX_BYTES;
+    protocol.setRetention("/fire", fire);
+
+    std::vector<std::string> frames = makeFrames(policeId, fireId);
+    std::vector<std::string> batch;
+    long baseline = 0;
+    bool ok = true;
+    std::cout << (lazy ? "lazy" : "eager") << " reports:" << std::endl;
+    for (int round = 1; round <= ROUNDS; ++round) {
+        for (size_t i = 0; i < frames.size(); i += BATCH) {
+            batch.assign(frames.begin() + i, frames.begin() + std::min(frames.size(), i + BATCH));
+            protocol.processFrames(batch);
+        }
+        if (round == WARM_UP_ROUNDS) baseline = residentKb();
+        if (round % 10 != 0) continue;
+
+        std::map<std::string, ReportStoreUsage> usage = protocol.getMemoryUsage();
+        long growth = residentKb() - baseline;
+        std::cout << "  " << round * frames.size() << " messages: rss +" << growth << " kB since warm-up, police "
+                  << usage["/police"].reports << " reports, fire " << usage["/fire"].reports << " reports / "
+                  << usage["/fire"].bytes << " bytes" << std::endl;
+        if (usage["/police"].reports > POLICE_MAX_REPORTS || usage["/fire"].bytes > FIRE_MAX_BYTES) {
+            std::cout << "FAILED: a store outgrew its retention policy" << std::endl;
+            ok = false;
+        }
+        if (growth > MAX_GROWTH_KB) {
+            std::cout << "FAILED: resident set grew by " << growth << " kB" << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+} // namespace
+
+int main() {
+    bool ok = soak(false);
+    ok = soak(true) && ok;
+    std::cout << (ok ? "soak test passed" : "soak test FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
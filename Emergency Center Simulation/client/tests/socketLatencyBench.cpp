@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "../include/ConnectionHandler.h"
+
+/**
+* Connects a ConnectionHandler to an in-process server over TCP loopback and
+* over a Unix-domain socket, with each of the SocketOptions variants, and
+* measures SUBSCRIBE/RECEIPT round trips: the client sends a frame, the
+* server answers with its receipt and the client waits for it. Prints p50 and
+* p99 latency per variant. Then sends a burst of frames before reading any
+* receipt. Checks that every receipt comes back, in order, with the right id.
+*/
+namespace {
+
+const size_t ROUND_TRIPS = 20000;
+const size_t WARM_UP = 1000;
+const size_t BURST = 64; // small enough for the 4k buffer variants to hold every frame and receipt
+const char* const SOCKET_PATH = "bin/socketLatencyBench.sock";
+
+// Accepts one connection and answers every '\0'-terminated frame with a RECEIPT for its receipt header
+class ReceiptServer {
+private:
+    int listener;
+    unsigned short port;
+    std::thread thread;
+
+    static bool sendAll(int fd, const std::string& data) {
+        for (size_t sent = 0; sent < data.size();) {
+            ssize_t count = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (count <= 0) return false;
+            sent += count;
+        }
+        return true;
+    }
+
+    void serve() {
+        int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0) return;
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); // fails harmlessly on a Unix socket
+        std::string received;
+        std::string replies;
+        char chunk[64 << 10];
+        ssize_t count;
+        while ((count = ::recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+            received.append(chunk, count);
+            size_t start = 0;
+            size_t end;
+            while ((end = received.find('\0', start)) != std::string::npos) {
+                size_t header = received.find("\nreceipt:", start);
+                if (header != std::string::npos && header < end) {
+                    size_t id = header + 9;
+                    replies.append("RECEIPT\nreceipt-id:").append(received, id, received.find('\n', id) - id).append("\n\n");
+                    replies.push_back('\0');
+                }
+                start = end + 1;
+            }
+            received.erase(0, start);
+            if (!sendAll(fd, replies)) break;
+            replies.clear();
+        }
+        ::close(fd);
+    }
+
+public:
+    // Listens on 127.0.0.1 at a free port, or on SOCKET_PATH when local
+    explicit ReceiptServer(bool local) : listener(-1), port(0), thread() {
+        if (local) {
+            ::unlink(SOCKET_PATH);
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            std::strncpy(address.sun_path, SOCKET_PATH, sizeof(address.sun_path) - 1);
+            listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) return;
+        } else {
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            listener = ::socket(AF_INET, SOCK_STREAM, 0);
+            socklen_t length = sizeof(address);
+            if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+                ::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+                return;
+            }
+            port = ntohs(address.sin_port);
+        }
+        if (::listen(listener, 1) == 0) thread = std::thread(&ReceiptServer::serve, this);
+    }
+
+    ~ReceiptServer() {
+        ::shutdown(listener, SHUT_RDWR); // wakes accept if the client never connected
+        if (thread.joinable()) thread.join();
+        ::close(listener);
+        ::unlink(SOCKET_PATH);
+    }
+
+    ReceiptServer(const ReceiptServer&) = delete;
+    ReceiptServer& operator=(const ReceiptServer&) = delete;
+
+    bool listening() const { return thread.joinable(); }
+    unsigned short getPort() const { return port; }
+};
+
+struct Variant {
+    std::string name;
+    bool local;
+    SocketOptions options;
+};
+
+std::vector<Variant> variants() {
+    std::vector<Variant> all;
+    SocketOptions options;
+    all.push_back({"tcp default", false, options});
+    options.noDelay = true;
+    all.push_back({"tcp nodelay", false, options});
+    options.quickAck = true;
+    all.push_back({"tcp nodelay+quickack", false, options});
+    options.quickAck = false;
+    options.busyPollMicros = 50;
+    all.push_back({"tcp nodelay+busypoll", false, options});
+    options.busyPollMicros = 0;
+    options.sendBuffer = options.receiveBuffer = 4096;
+    all.push_back({"tcp nodelay+4k buffers", false, options});
+    all.push_back({"unix", true, SocketOptions()});
+    options = SocketOptions();
+    options.sendBuffer = options.receiveBuffer = 4096;
+    all.push_back({"unix 4k buffers", true, options});
+    return all;
+}
+
+std::string subscribe(size_t id) {
+    return "SUBSCRIBE\ndestination:/police\nid:" + std::to_string(id) + "\nreceipt:" + std::to_string(id) + "\n\n";
+}
+
+bool isReceipt(const std::string& frame, size_t id) {
+    return frame == "RECEIPT\nreceipt-id:" + std::to_string(id) + "\n\n";
+}
+
+// Whether every round trip and the burst got their receipts; prints the latencies
+bool measure(const Variant& variant) {
+    ReceiptServer server(variant.local);
+    if (!server.listening()) {
+        std::cout << "FAILED: " << variant.name << ": cannot listen" << std::endl;
+        return false;
+    }
+    std::string host = variant.local ? std::string(UNIX_HOST_PREFIX) + SOCKET_PATH : "127.0.0.1";
+    ConnectionHandler handler(host, static_cast<short>(server.getPort()), variant.options);
+    if (!handler.connect(false)) {
+        std::cout << "FAILED: " << variant.name << ": cannot connect" << std::endl;
+        return false;
+    }
+
+    std::vector<double> micros;
+    micros.reserve(ROUND_TRIPS);
+    size_t lost = 0;
+    std::string frame;
+    for (size_t i = 0; i < WARM_UP + ROUND_TRIPS; ++i) {
+        std::string request = subscribe(i);
+        frame.clear();
+        auto start = std::chrono::steady_clock::now();
+        bool answered = handler.sendFrameAscii(request, '\0') && handler.getFrameAscii(frame, '\0');
+        double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        if (!answered || !isReceipt(frame, i)) {
+            ++lost;
+            if (!answered) break;
+        }
+        if (i >= WARM_UP) micros.push_back(elapsed);
+    }
+
+    size_t burstLost = 0;
+    for (size_t i = 0; i < BURST; ++i) {
+        if (!handler.sendFrameAscii(subscribe(i), '\0')) {
+            burstLost = BURST - i;
+            break;
+        }
+    }
+    for (size_t i = 0; i < BURST && burstLost == 0; ++i) {
+        frame.clear();
+        if (!handler.getFrameAscii(frame, '\0')) burstLost = BURST - i;
+        else if (!isReceipt(frame, i)) ++burstLost;
+    }
+    handler.close();
+
+    std::sort(micros.begin(), micros.end());
+    if (!micros.empty()) {
+        std::cout << "  " << variant.name << std::string(24 - std::min<size_t>(24, variant.name.size()), ' ') << "p50 "
+                  << micros[micros.size() / 2] << " us  p99 " << micros[micros.size() * 99 / 100] << " us" << std::endl;
+    }
+    if (lost != 0 || burstLost != 0) {
+        std::cout << "FAILED: " << variant.name << ": " << lost << " round trips and " << burstLost
+                  << " burst frames without their receipt" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    bool ok = true;
+    std::cout << ROUND_TRIPS << " SUBSCRIBE/RECEIPT round trips per variant, then a burst of " << BURST << ":" << std::endl;
+    for (const Variant& variant : variants()) ok = measure(variant) && ok;
+    std::cout << (ok ? "socket latency benchmark passed" : "socket latency benchmark FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "../include/ConnectionHandler.h"
+#include "../include/Metrics.h"
+#include "../include/UringSocket.h"
+
+/**
+* Compares ConnectionHandler's asio and io_uring paths against an in-process
+* server over TCP loopback and a Unix-domain socket: SUBSCRIBE/RECEIPT round
+* trips (p50 and p99), a flood of MESSAGE frames the server writes as fast as
+* it can, and a bulk of SEND frames the client writes as fast as it can.
+* Every receipt must come back with its id and every frame must arrive intact
+* and in order, and the io_uring path may not receive a flood much slower
+* than asio. Exits successfully without measuring when io_uring is
+* unavailable.
+*/
+namespace {
+
+const size_t ROUND_TRIPS = 10000;
+const size_t BULK_FRAMES = 200000;
+const size_t BODY_SIZE = 300;
+const char* const SOCKET_PATH = "bin/uringBench.sock";
+// How fast io_uring must receive a flood relative to asio; reads are buffered on both paths,
+// so they run about even and this only catches a multishot receive that stopped batching
+const double MIN_FLOOD_RATIO = 0.8;
+
+std::string subscribe(size_t id) {
+    return "SUBSCRIBE\ndestination:/police\nid:" + std::to_string(id) + "\nreceipt:" + std::to_string(id) + "\n\n";
+}
+
+std::string receipt(size_t id) {
+    return "RECEIPT\nreceipt-id:" + std::to_string(id) + "\n\n";
+}
+
+// A MESSAGE or SEND frame whose headers and body depend on id
+std::string bulkFrame(const char* command, size_t id) {
+    std::string frame = std::string(command) + "\nsubscription:0\nmessage-id:" + std::to_string(id) + "\ndestination:/police\n\n";
+    for (size_t i = 0; i < BODY_SIZE; ++i) frame.push_back(static_cast<char>('a' + (id + i) % 26));
+    return frame;
+}
+
+// Serves one connection: answers receipts, floods MESSAGE frames, or counts the frames it receives
+class TestServer {
+public:
+    enum Mode { RECEIPTS, FLOOD, SINK };
+
+private:
+    Mode mode;
+    int listener;
+    unsigned short port;
+    size_t framesReceived;
+    std::thread thread;
+
+    static bool sendAll(int fd, const std::string& data) {
+        for (size_t sent = 0; sent < data.size();) {
+            ssize_t count = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (count <= 0) return false;
+            sent += count;
+        }
+        return true;
+    }
+
+    void flood(int fd) {
+        std::string batch;
+        for (size_t i = 0; i < BULK_FRAMES; ++i) {
+            batch.append(bulkFrame("MESSAGE", i)).push_back('\0');
+            if (batch.size() >= (64 << 10) || i + 1 == BULK_FRAMES) {
+                if (!sendAll(fd, batch)) return;
+                batch.clear();
+            }
+        }
+    }
+
+    void serve() {
+        int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0) return;
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); // fails harmlessly on a Unix socket
+        if (mode == FLOOD) {
+            flood(fd);
+            ::close(fd);
+            return;
+        }
+        std::string received;
+        std::string replies;
+        char chunk[64 << 10];
+        ssize_t count;
+        while ((count = ::recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+            if (mode == SINK) {
+                framesReceived += std::count(chunk, chunk + count, '\0');
+                continue;
+            }
+            received.append(chunk, count);
+            size_t start = 0;
+            size_t end;
+            while ((end = received.find('\0', start)) != std::string::npos) {
+                size_t header = received.find("\nreceipt:", start);
+                if (header != std::string::npos && header < end) {
+                    size_t id = header + 9;
+                    replies.append("RECEIPT\nreceipt-id:").append(received, id, received.find('\n', id) - id).append("\n\n");
+                    replies.push_back('\0');
+                }
+                start = end + 1;
+            }
+            received.erase(0, start);
+            if (!sendAll(fd, replies)) break;
+            replies.clear();
+        }
+        ::close(fd);
+    }
+
+public:
+    // Listens on 127.0.0.1 at a free port, or on SOCKET_PATH when local
+    TestServer(Mode mode, bool local) : mode(mode), listener(-1), port(0), framesReceived(0), thread() {
+        if (local) {
+            ::unlink(SOCKET_PATH);
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            std::strncpy(address.sun_path, SOCKET_PATH, sizeof(address.sun_path) - 1);
+            listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) return;
+        } else {
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            listener = ::socket(AF_INET, SOCK_STREAM, 0);
+            socklen_t length = sizeof(address);
+            if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+                ::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+                return;
+            }
+            port = ntohs(address.sin_port);
+        }
+        if (::listen(listener, 1) == 0) thread = std::thread(&TestServer::serve, this);
+    }
+
+    ~TestServer() {
+        finish();
+        ::close(listener);
+        ::unlink(SOCKET_PATH);
+    }
+
+    TestServer(const TestServer&) = delete;
+    TestServer& operator=(const TestServer&) = delete;
+
+    bool listening() const { return thread.joinable(); }
+    unsigned short getPort() const { return port; }
+
+    // Waits for the connection to end; returns how many frames a SINK received
+    size_t finish() {
+        ::shutdown(listener, SHUT_RDWR); // wakes accept if the client never connected
+        if (thread.joinable()) thread.join();
+        return framesReceived;
+    }
+};
+
+struct Transport {
+    const char* name;
+    bool local;
+};
+
+struct Result {
+    double p50;
+    double p99;
+    double floodRate;
+    uint64_t floodReads;
+    double sendRate;
+    bool ok;
+};
+
+bool connect(ConnectionHandler& handler, const char* what) {
+    if (handler.connect(false)) return true;
+    std::cout << "FAILED: cannot connect for the " << what << std::endl;
+    return false;
+}
+
+std::string hostFor(const Transport& transport) {
+    return transport.local ? std::string(UNIX_HOST_PREFIX) + SOCKET_PATH : "127.0.0.1";
+}
+
+void roundTrips(const Transport& transport, const SocketOptions& options, Result& result) {
+    TestServer server(TestServer::RECEIPTS, transport.local);
+    ConnectionHandler handler(hostFor(transport), static_cast<short>(server.getPort()), options);
+    if (!server.listening() || !connect(handler, "round trips")) {
+        result.ok = false;
+        return;
+    }
+    std::vector<double> micros;
+    std::string frame;
+    for (size_t i = 0; i < ROUND_TRIPS; ++i) {
+        std::string request = subscribe(i);
+        frame.clear();
+        auto start = std::chrono::steady_clock::now();
+        bool answered = handler.sendFrameAscii(request, '\0') && handler.getFrameAscii(frame, '\0');
+        micros.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        if (!answered || frame != receipt(i)) {
+            std::cout << "FAILED: round trip " << i << " got no receipt" << std::endl;
+            result.ok = false;
+            break;
+        }
+    }
+    handler.close();
+    std::sort(micros.begin(), micros.end());
+    result.p50 = micros[micros.size() / 2];
+    result.p99 = micros[micros.size() * 99 / 100];
+}
+
+void receiveFlood(const Transport& transport, const SocketOptions& options, Result& result) {
+    TestServer server(TestServer::FLOOD, transport.local);
+    ConnectionHandler handler(hostFor(transport), static_cast<short>(server.getPort()), options);
+    if (!server.listening() || !connect(handler, "flood")) {
+        result.ok = false;
+        return;
+    }
+    uint64_t readsBefore = Metrics::snapshot().counters[Metrics::SocketReads];
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> frames(BULK_FRAMES);
+    size_t received = 0;
+    while (received < BULK_FRAMES && handler.getFrameAscii(frames[received], '\0')) ++received;
+    result.floodRate = received / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.floodReads = Metrics::snapshot().counters[Metrics::SocketReads] - readsBefore;
+    handler.close();
+
+    size_t intact = 0;
+    while (intact < received && frames[intact] == bulkFrame("MESSAGE", intact)) ++intact;
+    if (intact != BULK_FRAMES) {
+        std::cout << "FAILED: " << received << " flood frames received, the first " << intact << " intact" << std::endl;
+        result.ok = false;
+    }
+}
+
+void sendBulk(const Transport& transport, const SocketOptions& options, Result& result) {
+    TestServer server(TestServer::SINK, transport.local);
+    ConnectionHandler handler(hostFor(transport), static_cast<short>(server.getPort()), options);
+    if (!server.listening() || !connect(handler, "bulk send")) {
+        result.ok = false;
+        return;
+    }
+    std::vector<std::string> frames;
+    for (size_t i = 0; i < BULK_FRAMES; ++i) frames.push_back(bulkFrame("SEND", i));
+    auto start = std::chrono::steady_clock::now();
+    size_t sent = 0;
+    while (sent < BULK_FRAMES && handler.sendFrameAscii(frames[sent], '\0')) ++sent;
+    handler.close();
+    size_t arrived = server.finish();
+    result.sendRate = sent / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (sent != BULK_FRAMES || arrived != BULK_FRAMES) {
+        std::cout << "FAILED: " << sent << " bulk frames sent, " << arrived << " arrived" << std::endl;
+        result.ok = false;
+    }
+}
+
+Result measure(const Transport& transport, bool ioUring) {
+    SocketOptions options;
+    options.noDelay = true;
+    options.ioUring = ioUring;
+    Result result{0, 0, 0, 0, 0, true};
+    roundTrips(transport, options, result);
+    receiveFlood(transport, options, result);
+    sendBulk(transport, options, result);
+    std::cout << "  " << transport.name << (ioUring ? " uring" : " asio ") << "  round trip p50 " << result.p50
+              << " us p99 " << result.p99 << " us, flood " << result.floodRate << " frames/s";
+    if (!ioUring) std::cout << " (" << result.floodReads << " reads)";
+    std::cout << ", bulk send " << result.sendRate << " frames/s" << std::endl;
+    return result;
+}
+
+} // namespace
+
+int main() {
+    // Probe on a socket pair, so an unavailable io_uring is not mistaken for a slow one
+    int pair[2];
+    std::string error;
+    bool available = ::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0 && UringSocket::open(pair[0], false, error) != nullptr;
+    ::close(pair[0]);
+    ::close(pair[1]);
+    if (!available) {
+        std::cout << "io_uring unavailable (" << error << "), nothing to compare" << std::endl;
+        std::cout << "uring benchmark skipped" << std::endl;
+        return 0;
+    }
+
+    bool ok = true;
+    std::cout << ROUND_TRIPS << " round trips, " << BULK_FRAMES << " frames of " << BODY_SIZE + 64
+              << " B each way, TCP_NODELAY:" << std::endl;
+    for (const Transport& transport : {Transport{"tcp ", false}, Transport{"unix", true}}) {
+        Result asio = measure(transport, false);
+        Result uring = measure(transport, true);
+        ok = ok && asio.ok && uring.ok;
+        if (uring.floodRate < MIN_FLOOD_RATIO * asio.floodRate) {
+            std::cout << "FAILED: io_uring receives a flood over " << transport.name << " at only "
+                      << uring.floodRate / asio.floodRate << " times the rate of asio" << std::endl;
+            ok = false;
+        }
+    }
+    std::cout << (ok ? "uring benchmark passed" : "uring benchmark FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -119,6 +119,7 @@ public class StompMessagingProtocolImpl implements StompMessagingProtocol<String
         String[] lines = message.split("\n");
         String destination = "";
         String receipt = null;
+        String contentEncoding = null;
         StringBuilder body = new StringBuilder();
         boolean isBody = false;
 
@@ -128,6 +129,8 @@ public class StompMessagingProtocolImpl implements StompMessagingProtocol<String
                 destination = line.split(":", 2)[1].trim();
             } else if (line.startsWith("receipt:")) {
                 receipt = line.split(":", 2)[1].trim();
+            } else if (!isBody && line.startsWith("content-encoding:")) {
+                contentEncoding = line.split(":", 2)[1].trim(); // Passed on to subscribers untouched
             } else if (line.isEmpty()) {
                 isBody = true; // Body starts after an empty line
             } else if (isBody) {
@@ -161,7 +164,8 @@ public class StompMessagingProtocolImpl implements StompMessagingProtocol<String
             String messageToSend = "MESSAGE\n" +
                                 "subscription:" + subscriptionId + "\n" +
                                 "message-id:" + messageId + "\n" +
-                                "destination:" + destination + "\n\n" +
+                                "destination:" + destination + "\n" +
+                                (contentEncoding != null ? "content-encoding:" + contentEncoding + "\n" : "") + "\n" +
                                 messageBody + "\n";
             //Send the MESSAGE frame to the subscriber
             connections.send(subscriberConnectionId, messageToSend);